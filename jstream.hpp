@@ -1,12 +1,85 @@
+// jstream needs C++20: concepts, requires-clauses, <bit> and <span>.
+#if __cplusplus < 201709L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201709L)
+#error "jstream.hpp requires C++20 (-std=c++20)"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#define JSTREAM_HAS_MMAP 1
+#else
+#define JSTREAM_HAS_MMAP 0
+#endif
+
+#if defined(__linux__) && __has_include(<pthread.h>)
+#include <pthread.h>
+#include <sched.h>
+#define JSTREAM_HAS_AFFINITY 1
+#else
+#define JSTREAM_HAS_AFFINITY 0
+#endif
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define JSTREAM_HAS_SSSE3 1
+#else
+#define JSTREAM_HAS_SSSE3 0
+#endif
 
 namespace jstream
 {
 template <typename S, typename F>
 class FilterStream;
 
+template <typename S, bool Adaptive, typename... F>
+class AdaptiveFilterStream;
+
+template <typename... T>
+class ColumnStream;
+
+template <typename S, std::size_t I, typename P>
+class ColumnFilterStream;
+
+template <typename... T>
+class ColumnFileWriter;
+
+template <typename... T>
+class ColumnFileStream;
+
 template <typename S, typename F>
 class TransformStream;
 
@@ -19,233 +92,5864 @@ class PeekStream;
 template <typename S>
 class LimitStream;
 
-template <typename CRTP>
-class Stream
+template <typename... S>
+class ZipStream;
+
+template <typename F, typename... S>
+class ZipWithStream;
+
+template <typename S, typename F, bool Monotonic>
+class TakeWhileStream;
+
+template <typename S, typename F, bool Monotonic>
+class DropWhileStream;
+
+template <typename S, typename K, typename A>
+class GroupAdjacentStream;
+
+template <typename S, typename K, typename A>
+class HashGroupStream;
+
+template <typename S, typename P>
+class ChunkByStream;
+
+template <typename S>
+class DistinctStream;
+
+template <typename T>
+class Cache;
+
+class Executor;
+
+class BitmapStream;
+
+template <typename S, typename Sorter, bool Ascending>
+class SortStream;
+
+template <typename S>
+class ParallelSourceStream;
+
+template <typename S, typename T, typename Op, bool Inclusive>
+class ScanStream;
+
+template <typename S>
+class AsyncStream;
+
+template <typename S, typename F, bool Ordered>
+class ParallelMapStream;
+
+template <typename S>
+class SampleStream;
+
+template <typename S>
+class SampleFractionStream;
+
+template <typename S>
+class WindowStream;
+
+template <typename S>
+class SlidingSumStream;
+
+template <typename S, typename Cmp>
+class SlidingExtremumStream;
+
+template <typename Cmp, typename... S>
+class MergeSortedStream;
+
+template <typename S, typename Cmp>
+class DynamicMergeSortedStream;
+
+template <typename A, typename B, typename Cmp>
+class IntersectSortedStream;
+
+template <typename A, typename B, typename Cmp>
+class UnionSortedStream;
+
+template <typename A, typename B, typename Cmp>
+class DifferenceSortedStream;
+
+enum class JoinKind
+{
+    inner,
+    left,
+    semi,
+    anti
+};
+
+template <JoinKind Kind>
+using join_t = std::integral_constant<JoinKind, Kind>;
+
+inline constexpr join_t<JoinKind::inner> innerJoin{};
+inline constexpr join_t<JoinKind::left> leftJoin{};
+inline constexpr join_t<JoinKind::semi> semiJoin{};
+inline constexpr join_t<JoinKind::anti> antiJoin{};
+
+template <typename L, typename R, typename LK, typename RK, JoinKind Kind>
+class HashJoinStream;
+
+template <typename S>
+concept BasicStream = requires(S &s) {
+    typename S::next_type;
+    typename S::value_type;
+    { s.empty() } -> std::convertible_to<bool>;
+    s.next();
+};
+
+// Streams whose remaining elements can be addressed by index: size() is the number of
+// elements left, at(i) the i-th of them, and skip(n) drops the first n.
+template <typename S>
+concept RandomAccessStream = requires(S &s, std::size_t n) {
+    { s.size() } -> std::convertible_to<std::size_t>;
+    s.at(n);
+    s.skip(n);
+};
+
+// Random access streams backed by contiguous storage; data() points at the next element.
+template <typename S>
+concept ContiguousStream = RandomAccessStream<S> && requires(S &s) {
+    { s.data() } -> std::convertible_to<typename S::next_type>;
+};
+
+// Streams declaring `static constexpr bool sorted = true` yield their elements in ascending order.
+template <typename S>
+concept SortedStream = requires { requires S::sorted; };
+
+// Random access streams bound to an Executor by parallel().
+template <typename S>
+concept ParallelStream = RandomAccessStream<S> && requires(S &s) {
+    { s.executor() } -> std::same_as<Executor &>;
+};
+
+// Streams that can jump to the first element not less than a key: sources with a native skipTo
+// and random access streams, which gallop over at().
+template <typename S, typename K, typename Cmp = std::less<>>
+concept SeekableStream = RandomAccessStream<S> || requires(S &s, K const &key, Cmp &cmp) { s.skipTo(key, cmp); };
+
+// Tag promising that a predicate holds for a prefix of the stream and fails for the rest,
+// which lets random access streams binary search for the boundary, or that a grouping key is
+// monotone in the stream order, which lets groupBy work run by run.
+struct monotonic_t
+{
+    explicit monotonic_t() = default;
+};
+
+inline constexpr monotonic_t monotonic{};
+
+// Tag keeping adaptiveFilters() in the order written, e.g. to compare against the adaptive order
+// or when the first predicate guards the others.
+struct fixed_order_t
+{
+    explicit fixed_order_t() = default;
+};
+
+inline constexpr fixed_order_t fixedOrder{};
+
+namespace detail
+{
+inline constexpr std::size_t cacheBytes = std::size_t{1} << 20;
+
+constexpr std::uint64_t mix(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+template <typename K>
+constexpr std::uint64_t hash(K const &key) { return mix(std::hash<K>{}(key)); }
+
+template <RandomAccessStream S, typename F>
+constexpr std::size_t partitionPoint(S &s, F &f, std::size_t lo, std::size_t hi)
+{
+    while (lo < hi)
+    {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (f(s.at(mid)))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+template <RandomAccessStream S, typename F>
+constexpr std::size_t partitionPoint(S &s, F &f) { return partitionPoint(s, f, 0, s.size()); }
+
+// Exponential search for the partition point: O(log d) probes when the boundary is d elements away.
+template <RandomAccessStream S, typename F>
+constexpr std::size_t gallop(S &s, F &f)
+{
+    std::size_t n = s.size(), lo = 0, hi = 1;
+    while (hi <= n && f(s.at(hi - 1)))
+    {
+        lo = hi;
+        hi *= 2;
+    }
+    return partitionPoint(s, f, lo, std::min(hi, n));
+}
+
+template <typename S, typename K, typename Cmp>
+constexpr void skipTo(S &s, K const &key, Cmp &cmp)
+{
+    if constexpr (requires { s.skipTo(key, cmp); })
+        s.skipTo(key, cmp);
+    else if constexpr (RandomAccessStream<S>)
+    {
+        auto less = [&](auto const &v) { return cmp(v, key); };
+        s.skip(gallop(s, less));
+    }
+}
+
+// Tells a stream that nothing more will be pulled from it, so stages that produce ahead, such as
+// async(), can stop. Stages that pass elements through one at a time forward it upstream.
+template <typename S>
+constexpr void cancel(S &s)
+{
+    if constexpr (requires { s.cancel(); })
+        s.cancel();
+}
+
+// One-element lookahead over a sorted input. The head stays valid until the cursor is advanced
+// and then pulled again, matching the lifetime of pointers handed out by next().
+template <typename S>
+class Cursor
+{
+  public:
+    constexpr Cursor(S &s) : _stream(s) {}
+
+    constexpr typename S::next_type peek()
+    {
+        if (_pending)
+        {
+            _pending = false;
+            _head = _stream.empty() ? nullptr : _stream.next();
+        }
+        return _head;
+    }
+
+    constexpr typename S::next_type head() const { return _head; }
+
+    constexpr void advance() { _pending = true; }
+
+    template <typename K, typename Cmp>
+    constexpr void seek(K const &key, Cmp &cmp)
+    {
+        if (!peek() || !cmp(*_head, key))
+            return;
+        detail::skipTo(_stream, key, cmp);
+        do
+            _head = _stream.empty() ? nullptr : _stream.next();
+        while (_head && cmp(*_head, key));
+    }
+
+  private:
+    S &_stream;
+    typename S::next_type _head = nullptr;
+    bool _pending = true;
+};
+
+// Tournament tree over the heads of k sorted inputs: internal nodes keep the loser of their
+// match and _tree[0] the overall winner, so replacing the winner replays a single leaf-to-root
+// path of about log k comparisons. Exhausted inputs are null heads that lose every match.
+template <typename P, typename Cmp>
+class LoserTree
+{
+  public:
+    constexpr LoserTree(Cmp cmp) : _cmp(cmp) {}
+
+    constexpr void build(std::vector<P> heads)
+    {
+        _heads = std::move(heads);
+        _tree.assign(std::max<std::size_t>(_heads.size(), 1), 0);
+        if (!_heads.empty())
+            _tree[0] = build(1);
+    }
+
+    constexpr std::size_t winner() const { return _tree[0]; }
+
+    constexpr P top() const { return _heads.empty() ? nullptr : _heads[_tree[0]]; }
+
+    constexpr void replaceTop(P head)
+    {
+        std::size_t w = _tree[0];
+        _heads[w] = head;
+        for (std::size_t node = (w + _heads.size()) / 2; node > 0; node /= 2)
+            if (beats(_tree[node], w))
+                std::swap(_tree[node], w);
+        _tree[0] = w;
+    }
+
+  private:
+    constexpr std::size_t build(std::size_t node)
+    {
+        if (node >= _heads.size())
+            return node - _heads.size();
+        std::size_t l = build(2 * node), r = build(2 * node + 1);
+        bool left = beats(l, r);
+        _tree[node] = left ? r : l;
+        return left ? l : r;
+    }
+
+    // Ties go to the lower input index, which keeps the merge stable.
+    constexpr bool beats(std::size_t a, std::size_t b)
+    {
+        if (!_heads[a] || !_heads[b])
+            return _heads[a] || (!_heads[b] && a < b);
+        return a < b ? !_cmp(*_heads[b], *_heads[a]) : _cmp(*_heads[a], *_heads[b]);
+    }
+
+    Cmp _cmp;
+    std::vector<P> _heads;
+    std::vector<std::size_t> _tree;
+};
+
+// Rough footprint of one entry in a node based hash container.
+template <typename T>
+inline constexpr std::size_t nodeBytes = sizeof(T) + 3 * sizeof(void *);
+
+// Anonymous temporary file holding a raw binary run of trivially copyable values.
+template <typename T>
+class SpillFile
+{
+    static constexpr std::size_t capacity = std::max<std::size_t>(1, (std::size_t{1} << 16) / sizeof(T));
+
+  public:
+    SpillFile() : _file(std::tmpfile())
+    {
+        if (!_file)
+            throw std::system_error(errno, std::generic_category(), "jstream: cannot create spill file");
+    }
+
+    SpillFile(SpillFile const &) = delete;
+    SpillFile &operator=(SpillFile const &) = delete;
+
+    ~SpillFile() { std::fclose(_file); }
+
+    void write(T const &t)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be spilled");
+        if (_buffer.size() == capacity)
+            flush();
+        _buffer.push_back(t);
+    }
+
+    void rewind()
+    {
+        flush();
+        std::rewind(_file);
+        _position = 0;
+    }
+
+    bool read(T &t)
+    {
+        if (_position == _buffer.size())
+        {
+            _buffer.resize(capacity);
+            _buffer.resize(std::fread(_buffer.data(), sizeof(T), capacity, _file));
+            _position = 0;
+            if (_buffer.empty())
+                return false;
+        }
+        t = _buffer[_position++];
+        return true;
+    }
+
+  private:
+    void flush()
+    {
+        if (std::fwrite(_buffer.data(), sizeof(T), _buffer.size(), _file) != _buffer.size())
+            throw std::system_error(errno, std::generic_category(), "jstream: cannot write spill file");
+        _buffer.clear();
+    }
+
+    std::FILE *_file;
+    std::vector<T> _buffer;
+    std::size_t _position = 0;
+};
+
+// Spill files for one level of recursive hash partitioning. Each level splits on the next four
+// bits of the hash; past maxDepth the budget is ignored rather than splitting further.
+template <typename T>
+class Partitions
+{
+  public:
+    using file_type = std::unique_ptr<SpillFile<T>>;
+    using pending_type = std::vector<std::pair<file_type, std::size_t>>;
+
+    static constexpr std::size_t fanout = 16;
+    static constexpr std::size_t maxDepth = 4;
+
+    explicit Partitions(std::size_t depth) : _depth(depth) {}
+
+    // Whether a value with a new key must be spilled; once spilling starts it stays on.
+    bool spill(std::size_t memoryBytes, std::size_t budget)
+    {
+        if (_files.empty() && (memoryBytes < budget || _depth >= maxDepth))
+            return false;
+        _files.resize(fanout);
+        return true;
+    }
+
+    void add(std::uint64_t hash, T const &t)
+    {
+        file_type &file = _files[(hash >> (4 * _depth)) % fanout];
+        if (!file)
+            file = std::make_unique<SpillFile<T>>();
+        file->write(t);
+    }
+
+    void moveTo(pending_type &pending)
+    {
+        for (file_type &file : _files)
+            if (file)
+                pending.emplace_back(std::move(file), _depth + 1);
+        _files.clear();
+    }
+
+  private:
+    std::size_t _depth;
+    std::vector<file_type> _files;
+};
+} // namespace detail
+
+// Aggregators are reusable factories: bind<T>() returns a fresh accumulator for elements of type
+// T providing accumulate(), result() and merge() of another accumulator's partial state.
+template <typename A, typename T>
+using accumulator_t = decltype(std::declval<A const &>().template bind<T>());
+
+struct CountAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        std::size_t n = 0;
+
+        constexpr void accumulate(T const &) { n++; }
+        constexpr std::size_t result() const { return n; }
+        constexpr void merge(accumulator const &other) { n += other.n; }
+    };
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {}; }
+};
+
+struct SumAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        T sum{};
+
+        constexpr void accumulate(T const &t) { sum += t; }
+        constexpr T result() const { return sum; }
+        constexpr void merge(accumulator const &other) { sum += other.sum; }
+    };
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {}; }
+};
+
+template <typename Cmp>
+struct ExtremumAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        Cmp cmp;
+        std::optional<T> best;
+
+        constexpr void accumulate(T const &t)
+        {
+            if (!best || cmp(t, *best))
+                best = t;
+        }
+        constexpr std::optional<T> result() const { return best; }
+        constexpr void merge(accumulator const &other)
+        {
+            if (other.best)
+                accumulate(*other.best);
+        }
+    };
+
+    Cmp cmp;
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {cmp, std::nullopt}; }
+};
+
+template <typename I, typename F>
+struct ReducingAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        I value;
+        F op;
+
+        constexpr void accumulate(T const &t) { value = op(value, t); }
+        constexpr I result() const { return value; }
+        constexpr void merge(accumulator const &other) { value = op(value, other.value); }
+    };
+
+    I identity;
+    F op;
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {identity, op}; }
+};
+
+constexpr CountAggregator count() { return {}; }
+
+constexpr SumAggregator sum() { return {}; }
+
+template <typename Cmp = std::less<>>
+constexpr ExtremumAggregator<Cmp> min(Cmp cmp = {}) { return {cmp}; }
+
+template <typename Cmp = std::less<>>
+constexpr auto max(Cmp cmp = {})
+{
+    auto greater = [cmp](auto const &a, auto const &b) { return cmp(b, a); };
+    return ExtremumAggregator<decltype(greater)>{greater};
+}
+
+// reducing(identity, op) folds with op, which must also combine two partial results.
+template <typename I, typename F>
+constexpr ReducingAggregator<I, F> reducing(I identity, F op) { return {identity, op}; }
+
+// Short-circuiting aggregators also report done() once their result is settled; aggregate()
+// stops feeding them and stops traversal when all of them are done.
+template <typename F, bool StopOn, bool ResultIfStopped>
+struct MatchAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        F f;
+        bool stopped = false;
+
+        constexpr void accumulate(T const &t) { stopped = static_cast<bool>(f(t)) == StopOn; }
+        constexpr bool done() const { return stopped; }
+        constexpr bool result() const { return stopped == ResultIfStopped; }
+        constexpr void merge(accumulator const &other) { stopped |= other.stopped; }
+    };
+
+    F f;
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {f}; }
+};
+
+struct FindFirstAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        std::optional<T> first;
+
+        constexpr void accumulate(T const &t) { first = t; }
+        constexpr bool done() const { return first.has_value(); }
+        constexpr std::optional<T> result() const { return first; }
+        constexpr void merge(accumulator const &other)
+        {
+            if (!first)
+                first = other.first;
+        }
+    };
+
+    template <typename T>
+    constexpr accumulator<T> bind() const { return {}; }
+};
+
+template <typename F>
+constexpr MatchAggregator<F, true, true> anyMatch(F f) { return {f}; }
+
+template <typename F>
+constexpr MatchAggregator<F, false, false> allMatch(F f) { return {f}; }
+
+template <typename F>
+constexpr MatchAggregator<F, true, false> noneMatch(F f) { return {f}; }
+
+constexpr FindFirstAggregator findFirst() { return {}; }
+
+template <typename A>
+concept ShortCircuitAccumulator = requires(A const &a) { { a.done() } -> std::convertible_to<bool>; };
+
+// Count, sum, extrema, mean and variance in one pass. The mean and the sum of squared deviations
+// follow Welford's update per element and Chan's formula when merging partial states.
+template <typename T>
+class SummaryStatistics
+{
+  public:
+    using sum_type = std::conditional_t<std::is_floating_point_v<T>, T,
+                     std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    constexpr void accumulate(T const &t)
+    {
+        _count++;
+        _sum += t;
+        _min = _count == 1 || t < _min ? t : _min;
+        _max = _count == 1 || _max < t ? t : _max;
+        double delta = t - _mean;
+        _mean += delta / _count;
+        _m2 += delta * (t - _mean);
+    }
+
+    // Block kernel: extrema and sum over independent lanes, then the block's squared deviations
+    // from its own mean while it is still in cache, merged in as one partial state.
+    constexpr void accumulate(std::span<T const> block)
+    {
+        constexpr std::size_t lanes = 8, blockSize = 2048;
+        for (; block.size() > blockSize; block = block.subspan(blockSize))
+            accumulate(block.first(blockSize));
+        if (block.size() < lanes)
+        {
+            for (T const &t : block)
+                accumulate(t);
+            return;
+        }
+        SummaryStatistics partial;
+        sum_type sum[lanes]{};
+        T lo[lanes], hi[lanes];
+        std::fill_n(lo, lanes, block[0]);
+        std::fill_n(hi, lanes, block[0]);
+        std::size_t n = block.size() - block.size() % lanes;
+        for (std::size_t i = 0; i < n; i += lanes)
+            for (std::size_t l = 0; l < lanes; l++)
+            {
+                T t = block[i + l];
+                sum[l] += t;
+                lo[l] = t < lo[l] ? t : lo[l];
+                hi[l] = hi[l] < t ? t : hi[l];
+            }
+        partial._count = n;
+        partial._min = *std::min_element(lo, lo + lanes);
+        partial._max = *std::max_element(hi, hi + lanes);
+        for (sum_type s : sum)
+            partial._sum += s;
+        partial._mean = static_cast<double>(partial._sum) / n;
+        double m2[lanes]{};
+        for (std::size_t i = 0; i < n; i += lanes)
+            for (std::size_t l = 0; l < lanes; l++)
+            {
+                double d = block[i + l] - partial._mean;
+                m2[l] += d * d;
+            }
+        for (double d : m2)
+            partial._m2 += d;
+        merge(partial);
+        for (std::size_t i = n; i < block.size(); i++)
+            accumulate(block[i]);
+    }
+
+    constexpr void merge(SummaryStatistics const &other)
+    {
+        if (other._count == 0)
+            return;
+        if (_count == 0)
+        {
+            *this = other;
+            return;
+        }
+        std::size_t count = _count + other._count;
+        double delta = other._mean - _mean;
+        _mean += delta * other._count / count;
+        _m2 += other._m2 + delta * delta * (static_cast<double>(_count) * other._count / count);
+        _count = count;
+        _sum += other._sum;
+        _min = other._min < _min ? other._min : _min;
+        _max = _max < other._max ? other._max : _max;
+    }
+
+    constexpr SummaryStatistics result() const { return *this; }
+
+    constexpr std::size_t count() const { return _count; }
+    constexpr sum_type sum() const { return _sum; }
+    constexpr T min() const { return _min; }
+    constexpr T max() const { return _max; }
+    constexpr double mean() const { return _mean; }
+    constexpr double variance() const { return _count ? _m2 / _count : 0; }
+    constexpr double sampleVariance() const { return _count > 1 ? _m2 / (_count - 1) : 0; }
+    double stddev() const { return std::sqrt(variance()); }
+
+  private:
+    std::size_t _count = 0;
+    sum_type _sum{};
+    T _min{};
+    T _max{};
+    double _mean = 0;
+    double _m2 = 0;
+};
+
+struct SummaryAggregator
+{
+    template <typename T>
+    constexpr SummaryStatistics<T> bind() const { return {}; }
+};
+
+constexpr SummaryAggregator summarizing() { return {}; }
+
+namespace detail
+{
+template <typename T>
+void write(std::ostream &out, T const &t)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be serialized");
+    out.write(reinterpret_cast<char const *>(&t), sizeof(T));
+}
+
+template <typename T>
+T read(std::istream &in)
+{
+    T t;
+    if (!in.read(reinterpret_cast<char *>(&t), sizeof(T)))
+        throw std::runtime_error("jstream: truncated input");
+    return t;
+}
+
+// splitmix64: a tiny deterministic generator for the sketches' coin flips and the samplers.
+class SplitMix
+{
+  public:
+    constexpr explicit SplitMix(std::uint64_t seed) : _state(seed) {}
+
+    constexpr std::uint64_t operator()() { return mix(_state += 0x9e3779b97f4a7c15ULL); }
+
+    // Uniform in (0, 1].
+    constexpr double uniform() { return ((*this)() >> 11) * 0x1.0p-53 + 0x1.0p-53; }
+
+  private:
+    std::uint64_t _state;
+};
+} // namespace detail
+
+// HyperLogLog++ distinct counter over 64-bit hashes. Small cardinalities are kept as a sparse
+// list of hashes and counted exactly; past m / 8 hashes it switches to 2^precision dense one
+// byte registers, with linear counting while many registers are still empty.
+class HyperLogLog
+{
+  public:
+    explicit HyperLogLog(int precision = 14) : _precision(std::clamp(precision, 4, 18)) {}
+
+    template <typename T>
+    void accumulate(T const &t) { add(detail::hash(t)); }
+
+    void add(std::uint64_t hash)
+    {
+        if (!_registers.empty())
+        {
+            std::uint8_t &r = _registers[hash >> (64 - _precision)];
+            r = std::max(r, rank(hash));
+            return;
+        }
+        _sparse.push_back(hash);
+        if (_sparse.size() >= 2 * sparseLimit())
+            compact();
+    }
+
+    void merge(HyperLogLog const &other)
+    {
+        if (other._precision != _precision)
+            throw std::invalid_argument("jstream: merging HyperLogLog sketches of different precision");
+        if (other._registers.empty())
+        {
+            for (std::uint64_t h : other._sparse)
+                add(h);
+            return;
+        }
+        densify();
+        for (std::size_t i = 0; i < _registers.size(); i++)
+            _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+
+    HyperLogLog result() const { return *this; }
+
+    double estimate() const
+    {
+        if (_registers.empty())
+        {
+            HyperLogLog compacted = *this;
+            compacted.compact();
+            if (compacted._registers.empty())
+                return static_cast<double>(compacted._sparse.size());
+            return compacted.estimate();
+        }
+        double m = static_cast<double>(_registers.size()), sum = 0;
+        std::size_t zeros = 0;
+        for (std::uint8_t r : _registers)
+        {
+            sum += std::ldexp(1.0, -r);
+            zeros += r == 0;
+        }
+        double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+        double raw = alpha * m * m / sum;
+        if (zeros > 0 && raw <= 2.5 * m)
+            return m * std::log(m / zeros);
+        return raw;
+    }
+
+    void serialize(std::ostream &out) const
+    {
+        HyperLogLog compacted = *this;
+        compacted.compact();
+        detail::write(out, static_cast<std::uint8_t>(_precision));
+        detail::write(out, static_cast<std::uint8_t>(!compacted._registers.empty()));
+        if (compacted._registers.empty())
+        {
+            detail::write(out, static_cast<std::uint64_t>(compacted._sparse.size()));
+            out.write(reinterpret_cast<char const *>(compacted._sparse.data()), compacted._sparse.size() * sizeof(std::uint64_t));
+        }
+        else
+            out.write(reinterpret_cast<char const *>(compacted._registers.data()), compacted._registers.size());
+    }
+
+    static HyperLogLog deserialize(std::istream &in)
+    {
+        HyperLogLog hll(detail::read<std::uint8_t>(in));
+        if (detail::read<std::uint8_t>(in))
+        {
+            hll._registers.resize(std::size_t{1} << hll._precision);
+            in.read(reinterpret_cast<char *>(hll._registers.data()), hll._registers.size());
+        }
+        else
+        {
+            hll._sparse.resize(detail::read<std::uint64_t>(in));
+            in.read(reinterpret_cast<char *>(hll._sparse.data()), hll._sparse.size() * sizeof(std::uint64_t));
+        }
+        if (!in)
+            throw std::runtime_error("jstream: truncated sketch");
+        return hll;
+    }
+
+  private:
+    std::size_t sparseLimit() const { return (std::size_t{1} << _precision) / 8; }
+
+    std::uint8_t rank(std::uint64_t hash) const
+    {
+        return static_cast<std::uint8_t>(std::countl_zero((hash << _precision) | (std::uint64_t{1} << (_precision - 1))) + 1);
+    }
+
+    void compact()
+    {
+        std::sort(_sparse.begin(), _sparse.end());
+        _sparse.erase(std::unique(_sparse.begin(), _sparse.end()), _sparse.end());
+        if (_sparse.size() > sparseLimit())
+            densify();
+    }
+
+    void densify()
+    {
+        if (!_registers.empty())
+            return;
+        _registers.resize(std::size_t{1} << _precision);
+        for (std::uint64_t h : std::exchange(_sparse, {}))
+            add(h);
+    }
+
+    int _precision;
+    std::vector<std::uint64_t> _sparse;
+    std::vector<std::uint8_t> _registers;
+};
+
+// KLL quantile sketch: a stack of compactors where level h holds items of weight 2^h. A full
+// level sorts itself and promotes every other item, picked by a coin flip, to the level above;
+// capacities shrink geometrically towards the bottom so memory stays O(k).
+template <typename T, typename Cmp = std::less<>>
+class KllSketch
+{
+  public:
+    explicit KllSketch(double eps = 0.01, Cmp cmp = {}, std::uint64_t seed = 0)
+        : _k(std::max<std::size_t>(8, static_cast<std::size_t>(std::ceil(3 / eps)))), _cmp(cmp), _random(seed)
+    {
+        grow();
+    }
+
+    void accumulate(T const &t)
+    {
+        _levels[0].push_back(t);
+        _count++;
+        if (++_size >= _maxSize)
+            compress();
+    }
+
+    void merge(KllSketch const &other)
+    {
+        while (_levels.size() < other._levels.size())
+            grow();
+        for (std::size_t h = 0; h < other._levels.size(); h++)
+            _levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+        _count += other._count;
+        _size += other._size;
+        while (_size >= _maxSize)
+            compress();
+    }
+
+    KllSketch result() const { return *this; }
+
+    std::size_t count() const { return _count; }
+
+    // Smallest retained item whose estimated normalized rank reaches q.
+    std::optional<T> quantile(double q) const
+    {
+        auto items = weighted();
+        if (items.empty())
+            return std::nullopt;
+        std::uint64_t total = 0, target;
+        for (auto const &item : items)
+            total += item.second;
+        target = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total));
+        std::uint64_t seen = 0;
+        for (auto const &[t, weight] : items)
+            if ((seen += weight) >= target)
+                return t;
+        return items.back().first;
+    }
+
+    // Estimated fraction of items not greater than t.
+    double rank(T const &t) const
+    {
+        std::uint64_t below = 0, total = 0;
+        for (std::size_t h = 0; h < _levels.size(); h++)
+            for (T const &item : _levels[h])
+            {
+                total += std::uint64_t{1} << h;
+                if (!_cmp(t, item))
+                    below += std::uint64_t{1} << h;
+            }
+        return total ? static_cast<double>(below) / total : 0;
+    }
+
+    void serialize(std::ostream &out) const
+    {
+        detail::write(out, static_cast<std::uint64_t>(_k));
+        detail::write(out, static_cast<std::uint64_t>(_count));
+        detail::write(out, static_cast<std::uint64_t>(_levels.size()));
+        for (auto const &level : _levels)
+        {
+            detail::write(out, static_cast<std::uint64_t>(level.size()));
+            for (T const &t : level)
+                detail::write(out, t);
+        }
+    }
+
+    static KllSketch deserialize(std::istream &in, Cmp cmp = {}, std::uint64_t seed = 0)
+    {
+        KllSketch sketch(1, cmp, seed);
+        sketch._k = detail::read<std::uint64_t>(in);
+        sketch._count = detail::read<std::uint64_t>(in);
+        sketch._levels.clear();
+        for (auto levels = detail::read<std::uint64_t>(in); sketch._levels.size() < levels;)
+        {
+            sketch.grow();
+            auto &level = sketch._levels.back();
+            level.resize(detail::read<std::uint64_t>(in));
+            for (T &t : level)
+                t = detail::read<T>(in);
+            sketch._size += level.size();
+        }
+        if (sketch._levels.empty())
+            sketch.grow();
+        return sketch;
+    }
+
+  private:
+    std::size_t capacity(std::size_t h) const
+    {
+        std::size_t depth = _levels.size() - h - 1;
+        return static_cast<std::size_t>(std::ceil(std::pow(2.0 / 3.0, depth) * _k)) + 1;
+    }
+
+    void grow()
+    {
+        _levels.emplace_back();
+        _maxSize = 0;
+        for (std::size_t h = 0; h < _levels.size(); h++)
+            _maxSize += capacity(h);
+    }
+
+    void compress()
+    {
+        for (std::size_t h = 0; h < _levels.size(); h++)
+        {
+            if (_levels[h].size() < capacity(h))
+                continue;
+            if (h + 1 == _levels.size())
+                grow();
+            auto &level = _levels[h];
+            std::sort(level.begin(), level.end(), _cmp);
+            std::size_t end = level.size() - level.size() % 2;
+            for (std::size_t i = _random() & 1; i < end; i += 2)
+                _levels[h + 1].push_back(level[i]);
+            level.erase(level.begin(), level.begin() + end);
+            _size = 0;
+            for (auto const &l : _levels)
+                _size += l.size();
+            if (_size < _maxSize)
+                break;
+        }
+    }
+
+    std::vector<std::pair<T, std::uint64_t>> weighted() const
+    {
+        std::vector<std::pair<T, std::uint64_t>> items;
+        for (std::size_t h = 0; h < _levels.size(); h++)
+            for (T const &t : _levels[h])
+                items.emplace_back(t, std::uint64_t{1} << h);
+        std::sort(items.begin(), items.end(), [this](auto const &a, auto const &b) { return _cmp(a.first, b.first); });
+        return items;
+    }
+
+    std::size_t _k;
+    Cmp _cmp;
+    detail::SplitMix _random;
+    std::vector<std::vector<T>> _levels;
+    std::size_t _size = 0;
+    std::size_t _maxSize = 0;
+    std::size_t _count = 0;
+};
+
+// SpaceSaving top-k: k counters in an indexed min-heap. An unseen item takes over the smallest
+// counter and inherits its count as overestimation error, so every count is an upper bound.
+template <typename T>
+class SpaceSaving
+{
+  public:
+    struct Counter
+    {
+        T item;
+        std::uint64_t count;
+        std::uint64_t error;
+    };
+
+    explicit SpaceSaving(std::size_t k = 10) : _k(std::max<std::size_t>(k, 1)) {}
+
+    void accumulate(T const &t) { add(t, 1, 0); }
+
+    void merge(SpaceSaving const &other)
+    {
+        std::uint64_t floor = _heap.size() == _k ? _heap[0].count : 0;
+        std::uint64_t otherFloor = other._heap.size() == other._k ? other._heap[0].count : 0;
+        std::unordered_map<T, Counter> merged;
+        for (Counter const &c : _heap)
+            merged.emplace(c.item, Counter{c.item, c.count + otherFloor, c.error + otherFloor});
+        for (Counter const &c : other._heap)
+        {
+            auto [it, inserted] = merged.try_emplace(c.item, Counter{c.item, c.count + floor, c.error + floor});
+            if (!inserted)
+            {
+                it->second.count += c.count - otherFloor;
+                it->second.error += c.error - otherFloor;
+            }
+        }
+        std::vector<Counter> counters;
+        for (auto &entry : merged)
+            counters.push_back(std::move(entry.second));
+        std::sort(counters.begin(), counters.end(), [](Counter const &a, Counter const &b) { return a.count > b.count; });
+        counters.resize(std::min(counters.size(), _k));
+        _heap.clear();
+        _index.clear();
+        for (Counter &c : counters)
+            push(std::move(c));
+    }
+
+    SpaceSaving result() const { return *this; }
+
+    // Counters by descending count; items whose count - error exceeds the next count are
+    // guaranteed to be in the true top-k.
+    std::vector<Counter> top() const
+    {
+        std::vector<Counter> counters = _heap;
+        std::sort(counters.begin(), counters.end(), [](Counter const &a, Counter const &b) { return a.count > b.count; });
+        return counters;
+    }
+
+    void serialize(std::ostream &out) const
+    {
+        detail::write(out, static_cast<std::uint64_t>(_k));
+        detail::write(out, static_cast<std::uint64_t>(_heap.size()));
+        for (Counter const &c : _heap)
+        {
+            detail::write(out, c.item);
+            detail::write(out, c.count);
+            detail::write(out, c.error);
+        }
+    }
+
+    static SpaceSaving deserialize(std::istream &in)
+    {
+        SpaceSaving sketch(detail::read<std::uint64_t>(in));
+        for (auto n = detail::read<std::uint64_t>(in); n > 0; n--)
+        {
+            T item = detail::read<T>(in);
+            std::uint64_t count = detail::read<std::uint64_t>(in);
+            sketch.push({item, count, detail::read<std::uint64_t>(in)});
+        }
+        return sketch;
+    }
+
+  private:
+    void add(T const &t, std::uint64_t count, std::uint64_t error)
+    {
+        if (auto it = _index.find(t); it != _index.end())
+        {
+            _heap[it->second].count += count;
+            _heap[it->second].error += error;
+            siftDown(it->second);
+        }
+        else if (_heap.size() < _k)
+            push({t, count, error});
+        else
+        {
+            Counter &min = _heap[0];
+            _index.erase(min.item);
+            min = {t, min.count + count, min.count + error};
+            _index[t] = 0;
+            siftDown(0);
+        }
+    }
+
+    void push(Counter c)
+    {
+        _index[c.item] = _heap.size();
+        _heap.push_back(std::move(c));
+        for (std::size_t i = _heap.size() - 1; i > 0 && _heap[i].count < _heap[(i - 1) / 2].count; i = (i - 1) / 2)
+            swap(i, (i - 1) / 2);
+    }
+
+    void siftDown(std::size_t i)
+    {
+        while (true)
+        {
+            std::size_t smallest = i;
+            for (std::size_t child = 2 * i + 1; child <= 2 * i + 2 && child < _heap.size(); child++)
+                if (_heap[child].count < _heap[smallest].count)
+                    smallest = child;
+            if (smallest == i)
+                return;
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void swap(std::size_t a, std::size_t b)
+    {
+        std::swap(_heap[a], _heap[b]);
+        _index[_heap[a].item] = a;
+        _index[_heap[b].item] = b;
+    }
+
+    std::size_t _k;
+    std::vector<Counter> _heap;
+    std::unordered_map<T, std::size_t> _index;
+};
+
+struct HyperLogLogAggregator
+{
+    int precision;
+
+    template <typename T>
+    HyperLogLog bind() const { return HyperLogLog{precision}; }
+};
+
+struct KllAggregator
+{
+    double eps;
+
+    template <typename T>
+    KllSketch<T> bind() const { return KllSketch<T>{eps}; }
+};
+
+struct SpaceSavingAggregator
+{
+    std::size_t k;
+
+    template <typename T>
+    SpaceSaving<T> bind() const { return SpaceSaving<T>{k}; }
+};
+
+inline HyperLogLogAggregator approxCountDistinct(int precision = 14) { return {precision}; }
+
+inline KllAggregator approxQuantiles(double eps = 0.01) { return {eps}; }
+
+inline SpaceSavingAggregator heavyHitters(std::size_t k = 10) { return {k}; }
+
+namespace detail
+{
+inline constexpr std::size_t cacheLine = 64;
+
+// Spins, then yields, then sleeps; for waits on another thread whose timing is unknown.
+class Backoff
+{
+  public:
+    void operator()()
+    {
+        if (_rounds >= 1024)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        else if (_rounds >= 64)
+            std::this_thread::yield();
+        _rounds++;
+    }
+
+    std::size_t rounds() const { return _rounds; }
+
+  private:
+    std::size_t _rounds = 0;
+};
+
+struct Task
+{
+    virtual ~Task() = default;
+    virtual void run() = 0;
+};
+
+template <typename F>
+struct FunctionTask : Task
+{
+    explicit FunctionTask(F f) : f(std::move(f)) {}
+
+    void run() override { f(); }
+
+    F f;
+};
+
+// Chase-Lev deque: the owning worker pushes and pops at the bottom, any other thread steals from
+// the top, and only the last element needs a CAS. Rings double when full; retired rings are kept
+// until destruction because a thief may still be reading one.
+class WorkDeque
+{
+  public:
+    WorkDeque() { _ring.store(grow(nullptr, 0, 0), std::memory_order_relaxed); }
+
+    void push(Task *task)
+    {
+        std::int64_t bottom = _bottom.load(std::memory_order_relaxed);
+        std::int64_t top = _top.load(std::memory_order_acquire);
+        Ring *ring = _ring.load(std::memory_order_relaxed);
+        if (bottom - top > std::int64_t(ring->mask))
+            ring = grow(ring, top, bottom);
+        ring->at(bottom).store(task, std::memory_order_relaxed);
+        _bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    Task *pop()
+    {
+        std::int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        Ring *ring = _ring.load(std::memory_order_relaxed);
+        _bottom.store(bottom, std::memory_order_seq_cst);
+        std::int64_t top = _top.load(std::memory_order_seq_cst);
+        Task *task = nullptr;
+        if (top <= bottom)
+        {
+            task = ring->at(bottom).load(std::memory_order_relaxed);
+            if (top != bottom)
+                return task;
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return task;
+    }
+
+    Task *steal()
+    {
+        std::int64_t top = _top.load(std::memory_order_seq_cst);
+        std::int64_t bottom = _bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+            return nullptr;
+        Task *task = _ring.load(std::memory_order_acquire)->at(top).load(std::memory_order_relaxed);
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+
+  private:
+    struct Ring
+    {
+        explicit Ring(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<Task *>[capacity]) {}
+
+        std::atomic<Task *> &at(std::int64_t i) { return slots[std::size_t(i) & mask]; }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<Task *>[]> slots;
+    };
+
+    Ring *grow(Ring *ring, std::int64_t top, std::int64_t bottom)
+    {
+        Ring *bigger = _rings.emplace_back(std::make_unique<Ring>(ring ? 2 * (ring->mask + 1) : 256)).get();
+        for (std::int64_t i = top; i < bottom; i++)
+            bigger->at(i).store(ring->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(cacheLine) std::atomic<std::int64_t> _top{0};
+    alignas(cacheLine) std::atomic<std::int64_t> _bottom{0};
+    std::atomic<Ring *> _ring;
+    std::vector<std::unique_ptr<Ring>> _rings;
+};
+
+} // namespace detail
+
+// Work-stealing thread pool shared by the parallel stages. Every worker owns a Chase-Lev deque;
+// tasks submitted from a worker go to its own deque, others to a shared injection queue, and idle
+// workers steal before going to sleep. Workers that wait on pool work (waitUntil, parallelFor)
+// run pending tasks meanwhile, so nested parallel pipelines neither deadlock nor add threads;
+// other threads block until a task finishes or reports progress with notify().
+class Executor
+{
+  public:
+    explicit Executor(std::size_t threads = 0, bool pinThreads = false)
+    {
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threads; i++)
+            _workers.push_back(std::make_unique<Worker>());
+        for (std::size_t i = 0; i < threads; i++)
+            _workers[i]->thread = std::thread([this, i, pinThreads] { work(i, pinThreads); });
+    }
+
+    Executor(Executor const &) = delete;
+    Executor &operator=(Executor const &) = delete;
+
+    // Outstanding tasks are dropped; callers must have waited for their work.
+    ~Executor()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        for (std::unique_ptr<Worker> &worker : _workers)
+            worker->thread.join();
+        for (std::unique_ptr<Worker> &worker : _workers)
+            while (detail::Task *task = worker->deque.pop())
+                delete task;
+        for (detail::Task *task : _injected)
+            delete task;
+    }
+
+    // The process-wide pool, one worker per core, started on first use.
+    static Executor &global()
+    {
+        static Executor executor;
+        return executor;
+    }
+
+    std::size_t concurrency() const { return _workers.size(); }
+
+    // f must not throw.
+    template <typename F>
+    void submit(F &&f)
+    {
+        detail::Task *task = new detail::FunctionTask<std::decay_t<F>>(std::forward<F>(f));
+        if (Worker *self = current())
+            self->deque.push(task);
+        else
+        {
+            std::lock_guard lock(_mutex);
+            _injected.push_back(task);
+            _injectedCount.fetch_add(1);
+        }
+        _pending.fetch_add(1);
+        if (_sleepers.load() > 0)
+        {
+            std::lock_guard lock(_mutex);
+            _wake.notify_one();
+        }
+    }
+
+    // Returns once done() holds. Workers run pool tasks meanwhile; other threads sleep and check
+    // done() again whenever a task finishes or calls notify().
+    template <typename P>
+    void waitUntil(P &&done)
+    {
+        if (Worker *self = current())
+        {
+            for (detail::Backoff backoff; !done();)
+            {
+                if (detail::Task *task = take(self))
+                {
+                    run(task);
+                    backoff = {};
+                }
+                else
+                    backoff();
+            }
+            return;
+        }
+        std::unique_lock lock(_waitMutex);
+        _waiters.fetch_add(1, std::memory_order_acq_rel);
+        _progress.wait(lock, [&] { return done(); });
+        _waiters.fetch_sub(1);
+    }
+
+    // Wakes threads blocked in waitUntil() to check their condition again. Tasks call it after
+    // making progress that someone may wait for, without holding locks that done() takes.
+    void notify()
+    {
+        // A read-modify-write rather than a load: if it misses a waiter that is just arriving, the
+        // waiter's increment reads from it and so sees the progress made before this call.
+        if (_waiters.fetch_add(0, std::memory_order_acq_rel) > 0)
+        {
+            std::lock_guard lock(_waitMutex);
+            _progress.notify_all();
+        }
+    }
+
+    // Calls f(i) for every i in [0, n), the calling thread taking part, and rethrows the first
+    // exception once all calls have finished.
+    template <typename F>
+    void parallelFor(std::size_t n, F &&f)
+    {
+        std::atomic<std::size_t> remaining{n};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        auto body = [&](std::size_t i) {
+            try
+            {
+                f(i);
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                    error = std::current_exception();
+            }
+            remaining.fetch_sub(1, std::memory_order_release);
+        };
+        for (std::size_t i = 1; i < n; i++)
+            submit([&body, i] { body(i); });
+        if (n)
+            body(0);
+        waitUntil([&] { return remaining.load(std::memory_order_acquire) == 0; });
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+  private:
+    struct Worker
+    {
+        detail::WorkDeque deque;
+        std::thread thread;
+    };
+
+    Worker *current() const
+    {
+        return _currentExecutor == this ? _workers[_currentWorker].get() : nullptr;
+    }
+
+    detail::Task *take(Worker *self)
+    {
+        detail::Task *task = self ? self->deque.pop() : nullptr;
+        if (!task && _injectedCount.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard lock(_mutex);
+            if (!_injected.empty())
+            {
+                task = _injected.front();
+                _injected.pop_front();
+                _injectedCount.fetch_sub(1);
+            }
+        }
+        for (std::size_t i = 0; !task && i < _workers.size(); i++)
+        {
+            Worker *victim = _workers[(_victim++ + i) % _workers.size()].get();
+            if (victim != self)
+                task = victim->deque.steal();
+        }
+        if (task)
+            _pending.fetch_sub(1);
+        return task;
+    }
+
+    void run(detail::Task *task)
+    {
+        task->run();
+        delete task;
+        notify();
+    }
+
+    void work(std::size_t index, [[maybe_unused]] bool pinThread)
+    {
+#if JSTREAM_HAS_AFFINITY
+        if (pinThread)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus);
+        }
+#endif
+        _currentExecutor = this;
+        _currentWorker = index;
+        _victim = index + 1;
+        while (true)
+        {
+            for (detail::Backoff backoff; backoff.rounds() < 64; backoff())
+                if (detail::Task *task = take(_workers[index].get()))
+                {
+                    run(task);
+                    backoff = {};
+                }
+            std::unique_lock lock(_mutex);
+            _sleepers.fetch_add(1);
+            _wake.wait(lock, [this] { return _stopping || _pending.load() > 0; });
+            _sleepers.fetch_sub(1);
+            if (_stopping)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<detail::Task *> _injected;
+    std::atomic<std::size_t> _injectedCount{0};
+    std::atomic<std::int64_t> _pending{0};
+    std::atomic<std::size_t> _sleepers{0};
+    bool _stopping = false;
+    std::mutex _waitMutex;
+    std::condition_variable _progress;
+    std::atomic<std::size_t> _waiters{0};
+
+    static inline thread_local Executor const *_currentExecutor = nullptr;
+    static inline thread_local std::size_t _currentWorker = 0;
+    static inline thread_local std::size_t _victim = 0;
+};
+
+namespace detail
+{
+// Parallel work over n indices is cut into about four ranges per worker, none smaller than a
+// thousand elements unless n is; range r covers [n * r / ranges, n * (r + 1) / ranges).
+inline std::size_t rangeCount(Executor &executor, std::size_t n) { return std::clamp<std::size_t>(n / 1024, 1, 4 * executor.concurrency()); }
+
+template <typename F>
+void parallelRanges(Executor &executor, std::size_t n, F &&visit)
+{
+    std::size_t ranges = rangeCount(executor, n);
+    executor.parallelFor(ranges, [&](std::size_t r) { visit(n * r / ranges, n * (r + 1) / ranges); });
+}
+
+// Writes the inclusive scan of in[0, n) continuing from carry to out and returns the new carry.
+// Eight elements at a time are scanned in registers with log2(8) shifted combines
+// (Hillis-Steele), which compilers lower to vector shuffles, before the carry is folded in.
+template <typename T, typename U, typename Op>
+constexpr T prefixScan(U const *in, T *out, std::size_t n, Op &op, T carry)
+{
+    constexpr std::size_t lanes = 8;
+    std::size_t i = 0;
+    for (std::size_t full = n - n % lanes; i < full; i += lanes)
+    {
+        T x[lanes];
+        for (std::size_t j = 0; j < lanes; j++)
+            x[j] = static_cast<T>(in[i + j]);
+        for (std::size_t shift = 1; shift < lanes; shift *= 2)
+            for (std::size_t j = lanes; j-- > shift;)
+                x[j] = op(x[j - shift], x[j]);
+        for (std::size_t j = 0; j < lanes; j++)
+            out[i + j] = op(carry, x[j]);
+        carry = out[i + lanes - 1];
+    }
+    for (; i < n; i++)
+        out[i] = carry = op(carry, static_cast<T>(in[i]));
+    return carry;
+}
+
+// Keys with an order-preserving map to unsigned integers, which radix sorts use as digits:
+// signed integers flip the sign bit, floats flip the sign bit when positive and every bit when
+// negative, so that negatives order below positives and by decreasing magnitude.
+template <typename K>
+concept RadixKey = std::is_integral_v<K> || (std::is_floating_point_v<K> && (sizeof(K) == 4 || sizeof(K) == 8));
+
+template <RadixKey K>
+constexpr auto radixKey(K k)
+{
+    if constexpr (std::is_same_v<K, bool>)
+        return std::uint8_t(k);
+    else if constexpr (std::is_floating_point_v<K>)
+    {
+        using U = std::conditional_t<sizeof(K) == 4, std::uint32_t, std::uint64_t>;
+        constexpr U sign = U(1) << (8 * sizeof(U) - 1);
+        U u = std::bit_cast<U>(k);
+        return U(u & sign ? ~u : u | sign);
+    }
+    else
+    {
+        using U = std::make_unsigned_t<K>;
+        return std::is_signed_v<K> ? U(U(k) ^ U(1) << (8 * sizeof(U) - 1)) : U(k);
+    }
+}
+
+// Hints that p will be written soon; a no-op on compilers without a prefetch builtin.
+inline void prefetchForWrite(void const *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 1);
+#else
+    (void)p;
+#endif
+}
+
+// Moves data[lo, hi) to scratch at offsets[digit(record)]++. The 256 write cursors are too many
+// for the hardware prefetcher to follow, so the slot of the record `ahead` places further on is
+// prefetched, from the histogram offsets, while the current one moves.
+template <typename R, typename D>
+void scatter(R *data, R *scratch, std::size_t lo, std::size_t hi, std::size_t *offsets, D &digit)
+{
+    constexpr std::size_t ahead = 16;
+    std::size_t i = lo;
+    for (; i + ahead < hi; i++)
+    {
+        prefetchForWrite(scratch + offsets[digit(data[i + ahead])]);
+        scratch[offsets[digit(data[i])]++] = std::move(data[i]);
+    }
+    for (; i < hi; i++)
+        scratch[offsets[digit(data[i])]++] = std::move(data[i]);
+}
+
+// LSD radix sort of data[0, n) by the low `bytes` bytes of key(record), a byte per pass, using
+// scratch[0, n) and returning whichever of the two ends up holding the result. The histograms of
+// all passes come from one read of the input, and passes on bytes shared by every key are skipped.
+template <typename R, typename F>
+R *radixSort(R *data, R *scratch, std::size_t n, F &key, std::size_t bytes)
+{
+    if (n < 2)
+        return data;
+    std::vector<std::array<std::size_t, 256>> counts(bytes);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        auto k = key(data[i]);
+        for (std::size_t b = 0; b < bytes; b++)
+            counts[b][k >> 8 * b & 255]++;
+    }
+    for (std::size_t b = 0; b < bytes; b++)
+    {
+        std::array<std::size_t, 256> &offsets = counts[b];
+        if (offsets[key(data[0]) >> 8 * b & 255] == n)
+            continue;
+        std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+        auto digit = [&](R const &r) { return key(r) >> 8 * b & 255; };
+        scatter(data, scratch, 0, n, offsets.data(), digit);
+        std::swap(data, scratch);
+    }
+    return data;
+}
+
+// Parallel MSD radix sort: the byte of highest significance on which keys differ splits the
+// records into 256 buckets (histograms and a stable scatter per index range), then every bucket
+// is LSD sorted on the lower bytes as a task of its own.
+template <typename R, typename F>
+void parallelRadixSort(Executor &executor, std::vector<R> &records, F &key)
+{
+    std::size_t n = records.size();
+    if (n < 2)
+        return;
+    auto first = key(records[0]);
+    decltype(first) differ = 0;
+    for (R const &r : records)
+        differ |= key(r) ^ first;
+    if (!differ)
+        return;
+    std::size_t top = (std::bit_width(differ) - 1) / 8;
+    auto digit = [&](R const &r) { return key(r) >> 8 * top & 255; };
+    std::vector<R> scratch(n);
+    std::size_t ranges = rangeCount(executor, n);
+    std::vector<std::array<std::size_t, 256>> offsets(ranges);
+    executor.parallelFor(ranges, [&](std::size_t r) {
+        for (std::size_t i = n * r / ranges, hi = n * (r + 1) / ranges; i < hi; i++)
+            offsets[r][digit(records[i])]++;
+    });
+    std::array<std::size_t, 257> buckets;
+    for (std::size_t d = 0, position = 0; d < 256; d++)
+    {
+        buckets[d] = position;
+        for (std::size_t r = 0; r < ranges; r++)
+            position += std::exchange(offsets[r][d], position);
+    }
+    buckets[256] = n;
+    executor.parallelFor(ranges, [&](std::size_t r) { scatter(records.data(), scratch.data(), n * r / ranges, n * (r + 1) / ranges, offsets[r].data(), digit); });
+    executor.parallelFor(256, [&](std::size_t d) {
+        std::size_t lo = buckets[d], count = buckets[d + 1] - lo;
+        R *sorted = radixSort(scratch.data() + lo, records.data() + lo, count, key, top);
+        if (sorted != records.data() + lo)
+            std::move(sorted, sorted + count, records.data() + lo);
+    });
+}
+
+struct Identity
+{
+    template <typename T>
+    constexpr T const &operator()(T const &t) const { return t; }
+};
+
+// Sorters hand a SortStream's materialized elements to a sort; the executor is set when the
+// upstream is parallel().
+template <typename Cmp>
+struct ComparisonSort
+{
+    Cmp cmp;
+
+    template <typename T>
+    void operator()(std::vector<T> &elements, Executor *) { std::sort(elements.begin(), elements.end(), cmp); }
+};
+
+// Big-endian packing of a string's first 8 bytes, so that comparing prefixes as integers agrees
+// with comparing the strings, up to ties.
+inline std::uint64_t keyPrefix(std::string_view s)
+{
+    std::uint64_t prefix = 0;
+    for (std::size_t i = 0; i < 8; i++)
+        prefix = prefix << 8 | (i < s.size() ? std::uint8_t(s[i]) : 0);
+    return prefix;
+}
+
+// Stable sort by cmp(key(a), key(b)), calling key once per element. Arithmetic keys in the
+// default order are radix sorted: elements that are their own key directly, other elements as
+// (key, index) pairs. Other keys are cached and an index array is sorted over them, with string
+// keys compared on (8-byte prefix, index) records first. Elements are then gathered by index.
+template <typename K, typename Cmp = std::less<>>
+struct KeySort
+{
+    K key;
+    Cmp cmp = {};
+
+    template <typename T>
+    void operator()(std::vector<T> &elements, Executor *executor)
+    {
+        using key_type = std::remove_cvref_t<std::invoke_result_t<K &, T const &>>;
+        constexpr bool less = std::is_same_v<Cmp, std::less<>>;
+        if constexpr (less && RadixKey<key_type> && std::is_same_v<K, Identity> && std::is_default_constructible_v<T>)
+            radix(elements, [](T const &t) { return radixKey(t); }, executor);
+        else if constexpr (less && RadixKey<key_type>)
+        {
+            using digits_type = decltype(radixKey(std::declval<key_type>()));
+            std::vector<std::pair<digits_type, std::size_t>> records(elements.size());
+            for (std::size_t i = 0; i < elements.size(); i++)
+                records[i] = {radixKey(key(elements[i])), i};
+            radix(records, [](auto const &record) { return record.first; }, executor);
+            gather(elements, records, [](auto const &record) { return record.second; });
+        }
+        else
+        {
+            std::vector<key_type> keys = cache<key_type>(elements, executor);
+            if constexpr (less && std::is_convertible_v<key_type const &, std::string_view>)
+            {
+                std::vector<std::pair<std::uint64_t, std::size_t>> records(elements.size());
+                for (std::size_t i = 0; i < elements.size(); i++)
+                    records[i] = {keyPrefix(keys[i]), i};
+                std::sort(records.begin(), records.end(), [&](auto const &a, auto const &b) {
+                    if (a.first != b.first)
+                        return a.first < b.first;
+                    if (int c = std::string_view(keys[a.second]).compare(std::string_view(keys[b.second])))
+                        return c < 0;
+                    return a.second < b.second;
+                });
+                gather(elements, records, [](auto const &record) { return record.second; });
+            }
+            else
+            {
+                std::vector<std::size_t> order(elements.size());
+                std::iota(order.begin(), order.end(), std::size_t(0));
+                std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return cmp(keys[a], keys[b]); });
+                gather(elements, order, [](std::size_t i) { return i; });
+            }
+        }
+    }
+
+    // Keys are computed across the executor, when there is one, if they can be assigned in place.
+    template <typename Key, typename T>
+    std::vector<Key> cache(std::vector<T> const &elements, Executor *executor)
+    {
+        std::vector<Key> keys;
+        if constexpr (std::is_default_constructible_v<Key>)
+            if (executor)
+            {
+                keys.resize(elements.size());
+                parallelRanges(*executor, elements.size(), [&](std::size_t lo, std::size_t hi) {
+                    for (std::size_t i = lo; i < hi; i++)
+                        keys[i] = key(elements[i]);
+                });
+                return keys;
+            }
+        keys.reserve(elements.size());
+        for (auto const &element : elements)
+            keys.push_back(key(element));
+        return keys;
+    }
+
+    template <typename T, typename R, typename I>
+    static void gather(std::vector<T> &elements, std::vector<R> const &records, I index)
+    {
+        std::vector<T> sorted;
+        sorted.reserve(elements.size());
+        for (auto const &record : records)
+            sorted.push_back(std::move(elements[index(record)]));
+        elements = std::move(sorted);
+    }
+
+    template <typename R, typename F>
+    static void radix(std::vector<R> &records, F digits, Executor *executor)
+    {
+        if (executor)
+            return parallelRadixSort(*executor, records, digits);
+        std::vector<R> scratch(records.size());
+        if (radixSort(records.data(), scratch.data(), records.size(), digits, sizeof(digits(records[0]))) != records.data())
+            records.swap(scratch);
+    }
+};
+} // namespace detail
+
+// Compressed set of 32-bit integers in the roaring layout: values are grouped by their high 16
+// bits, and each group's low halves are kept in whichever container is smallest: a sorted array
+// (up to 4096 values), a 65536-bit bitmap, or, after optimize(), a list of runs. Set operations
+// work container by container, on words wherever a bitmap is involved.
+class RoaringBitmap
+{
+    static constexpr std::size_t arrayLimit = 4096;
+    static constexpr std::size_t words = 1024;
+    static constexpr std::uint32_t none = 1 << 16;
+
+    struct Container
+    {
+        enum class Kind : std::uint8_t
+        {
+            array,
+            bitmap,
+            run,
+        };
+
+        Kind kind = Kind::array;
+        std::vector<std::uint16_t> values; // array: sorted values; run: (start, length - 1) pairs
+        std::vector<std::uint64_t> bits;
+        std::uint32_t cardinality = 0;
+
+        std::size_t runs() const { return values.size() / 2; }
+        std::uint32_t runEnd(std::size_t r) const { return std::uint32_t(values[2 * r]) + values[2 * r + 1]; }
+
+        bool contains(std::uint16_t v) const
+        {
+            std::size_t hint = 0;
+            return first(v, hint) == v;
+        }
+
+        // Smallest element not less than low, or `none`; hint remembers the array or run
+        // position so that ascending calls take constant time.
+        std::uint32_t first(std::uint32_t low, std::size_t &hint) const
+        {
+            if (low >= none)
+                return none;
+            switch (kind)
+            {
+            case Kind::array:
+                if (!(hint < values.size() && values[hint] >= low && (hint == 0 || values[hint - 1] < low)))
+                    hint = std::lower_bound(values.begin(), values.end(), low) - values.begin();
+                return hint < values.size() ? values[hint] : none;
+            case Kind::bitmap:
+            {
+                std::size_t w = low / 64;
+                for (std::uint64_t word = bits[w] & ~std::uint64_t{0} << low % 64;; word = bits[w])
+                {
+                    if (word)
+                        return std::uint32_t(w * 64 + std::countr_zero(word));
+                    if (++w == words)
+                        return none;
+                }
+            }
+            case Kind::run:
+                if (!(hint < runs() && low <= runEnd(hint) && (hint == 0 || runEnd(hint - 1) < low)))
+                {
+                    std::size_t lo = 0, hi = runs();
+                    while (lo < hi)
+                    {
+                        std::size_t mid = (lo + hi) / 2;
+                        if (runEnd(mid) < low)
+                            lo = mid + 1;
+                        else
+                            hi = mid;
+                    }
+                    hint = lo;
+                }
+                return hint < runs() ? std::max<std::uint32_t>(low, values[2 * hint]) : none;
+            }
+            return none;
+        }
+
+        std::vector<std::uint64_t> toBits() const
+        {
+            if (kind == Kind::bitmap)
+                return bits;
+            std::vector<std::uint64_t> out(words);
+            std::size_t hint = 0;
+            for (std::uint32_t v = first(0, hint); v != none; v = first(v + 1, hint))
+                out[v / 64] |= std::uint64_t{1} << v % 64;
+            return out;
+        }
+
+        static Container fromBits(std::vector<std::uint64_t> bits)
+        {
+            Container c;
+            for (std::uint64_t word : bits)
+                c.cardinality += std::popcount(word);
+            if (c.cardinality > arrayLimit)
+            {
+                c.kind = Kind::bitmap;
+                c.bits = std::move(bits);
+                return c;
+            }
+            c.values.reserve(c.cardinality);
+            for (std::size_t w = 0; w < words; w++)
+                for (std::uint64_t word = bits[w]; word; word &= word - 1)
+                    c.values.push_back(std::uint16_t(w * 64 + std::countr_zero(word)));
+            return c;
+        }
+
+        static Container fromArray(std::vector<std::uint16_t> values)
+        {
+            Container c;
+            c.cardinality = std::uint32_t(values.size());
+            c.values = std::move(values);
+            return c;
+        }
+
+        void add(std::uint16_t v)
+        {
+            if (kind == Kind::run)
+                *this = fromBits(toBits());
+            if (kind == Kind::array)
+            {
+                auto it = std::lower_bound(values.begin(), values.end(), v);
+                if (it != values.end() && *it == v)
+                    return;
+                if (values.size() < arrayLimit)
+                {
+                    values.insert(it, v);
+                    cardinality++;
+                    return;
+                }
+                bits = toBits();
+                values = {};
+                kind = Kind::bitmap;
+            }
+            std::uint64_t bit = std::uint64_t{1} << v % 64;
+            cardinality += !(bits[v / 64] & bit);
+            bits[v / 64] |= bit;
+        }
+
+        // Switches to runs when they are smaller than the current form.
+        void optimize()
+        {
+            std::vector<std::uint16_t> pairs;
+            std::size_t hint = 0;
+            for (std::uint32_t start = first(0, hint), end, next; start != none; start = next)
+            {
+                for (end = start; (next = first(end + 1, hint)) == end + 1;)
+                    end = next;
+                pairs.push_back(std::uint16_t(start));
+                pairs.push_back(std::uint16_t(end - start));
+            }
+            std::size_t current = kind == Kind::bitmap ? words * sizeof(std::uint64_t) : values.size() * sizeof(std::uint16_t);
+            if (pairs.size() * sizeof(std::uint16_t) < current)
+            {
+                kind = Kind::run;
+                values = std::move(pairs);
+                bits = {};
+            }
+        }
+
+        static Container intersect(Container const &a, Container const &b)
+        {
+            if (a.kind == Kind::array || b.kind == Kind::array)
+            {
+                Container const &small = a.kind == Kind::array ? a : b;
+                Container const &other = &small == &a ? b : a;
+                std::vector<std::uint16_t> values;
+                if (other.kind == Kind::array)
+                    std::set_intersection(small.values.begin(), small.values.end(), other.values.begin(), other.values.end(), std::back_inserter(values));
+                else
+                    std::copy_if(small.values.begin(), small.values.end(), std::back_inserter(values), [&](std::uint16_t v) { return other.contains(v); });
+                return fromArray(std::move(values));
+            }
+            return combine(a, b, [](std::uint64_t x, std::uint64_t y) { return x & y; });
+        }
+
+        static Container unite(Container const &a, Container const &b)
+        {
+            if (a.kind == Kind::array && b.kind == Kind::array && a.values.size() + b.values.size() <= arrayLimit)
+            {
+                std::vector<std::uint16_t> values;
+                std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), std::back_inserter(values));
+                return fromArray(std::move(values));
+            }
+            return combine(a, b, [](std::uint64_t x, std::uint64_t y) { return x | y; });
+        }
+
+        static Container subtract(Container const &a, Container const &b)
+        {
+            if (a.kind == Kind::array)
+            {
+                std::vector<std::uint16_t> values;
+                std::copy_if(a.values.begin(), a.values.end(), std::back_inserter(values), [&](std::uint16_t v) { return !b.contains(v); });
+                return fromArray(std::move(values));
+            }
+            return combine(a, b, [](std::uint64_t x, std::uint64_t y) { return x & ~y; });
+        }
+
+        template <typename Op>
+        static Container combine(Container const &a, Container const &b, Op op)
+        {
+            std::vector<std::uint64_t> x = a.toBits(), y = b.toBits();
+            for (std::size_t w = 0; w < words; w++)
+                x[w] = op(x[w], y[w]);
+            return fromBits(std::move(x));
+        }
+    };
+
+  public:
+    void add(std::uint32_t value)
+    {
+        std::uint16_t key = std::uint16_t(value >> 16);
+        auto it = !_keys.empty() && _keys.back() == key ? _keys.end() - 1 : std::lower_bound(_keys.begin(), _keys.end(), key);
+        if (it == _keys.end() || *it != key)
+            _containers.emplace(_containers.begin() + (it - _keys.begin())), it = _keys.insert(it, key);
+        _containers[it - _keys.begin()].add(std::uint16_t(value));
+    }
+
+    bool contains(std::uint32_t value) const
+    {
+        auto it = std::lower_bound(_keys.begin(), _keys.end(), std::uint16_t(value >> 16));
+        return it != _keys.end() && *it == value >> 16 && _containers[it - _keys.begin()].contains(std::uint16_t(value));
+    }
+
+    std::uint64_t cardinality() const
+    {
+        std::uint64_t n = 0;
+        for (Container const &c : _containers)
+            n += c.cardinality;
+        return n;
+    }
+
+    bool empty() const { return _keys.empty(); }
+
+    // Converts containers holding long runs of consecutive values to run containers.
+    void optimize()
+    {
+        for (Container &c : _containers)
+            c.optimize();
+    }
+
+    std::size_t bytes() const
+    {
+        std::size_t n = _keys.size() * (sizeof(std::uint16_t) + sizeof(Container));
+        for (Container const &c : _containers)
+            n += c.values.size() * sizeof(std::uint16_t) + c.bits.size() * sizeof(std::uint64_t);
+        return n;
+    }
+
+    friend RoaringBitmap operator&(RoaringBitmap const &a, RoaringBitmap const &b) { return merge(a, b, false, false, Container::intersect); }
+    friend RoaringBitmap operator|(RoaringBitmap const &a, RoaringBitmap const &b) { return merge(a, b, true, true, Container::unite); }
+    friend RoaringBitmap andNot(RoaringBitmap const &a, RoaringBitmap const &b) { return merge(a, b, true, false, Container::subtract); }
+
+    RoaringBitmap &operator&=(RoaringBitmap const &other) { return *this = *this & other; }
+    RoaringBitmap &operator|=(RoaringBitmap const &other) { return *this = *this | other; }
+
+  private:
+    friend class BitmapStream;
+
+    // Walks both key lists in order, combining containers present in both and copying those
+    // present on one side only when that side is kept.
+    template <typename F>
+    static RoaringBitmap merge(RoaringBitmap const &a, RoaringBitmap const &b, bool keepA, bool keepB, F combine)
+    {
+        RoaringBitmap r;
+        auto push = [&](std::uint16_t key, Container c) {
+            if (c.cardinality)
+            {
+                r._keys.push_back(key);
+                r._containers.push_back(std::move(c));
+            }
+        };
+        std::size_t i = 0, j = 0;
+        while (i < a._keys.size() || j < b._keys.size())
+        {
+            if (j == b._keys.size() || (i < a._keys.size() && a._keys[i] < b._keys[j]))
+            {
+                if (keepA)
+                    push(a._keys[i], a._containers[i]);
+                i++;
+            }
+            else if (i == a._keys.size() || b._keys[j] < a._keys[i])
+            {
+                if (keepB)
+                    push(b._keys[j], b._containers[j]);
+                j++;
+            }
+            else
+            {
+                push(a._keys[i], combine(a._containers[i], b._containers[j]));
+                i++;
+                j++;
+            }
+        }
+        return r;
+    }
+
+    std::vector<std::uint16_t> _keys;
+    std::vector<Container> _containers;
+};
+
+// Visible to qualified lookup too, not only through argument-dependent lookup.
+RoaringBitmap andNot(RoaringBitmap const &a, RoaringBitmap const &b);
+
+struct BitmapAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        RoaringBitmap bitmap;
+
+        void accumulate(T const &t) { bitmap.add(static_cast<std::uint32_t>(t)); }
+        RoaringBitmap const &result() const { return bitmap; }
+        void merge(accumulator const &other) { bitmap |= other.bitmap; }
+    };
+
+    template <typename T>
+    accumulator<T> bind() const { return {}; }
+};
+
+// Exact distinct count. Integers of up to 32 bits are counted in a RoaringBitmap, which stays
+// compact over small or clustered domains, rather than in a hash set.
+struct CountDistinctAggregator
+{
+    template <typename T>
+    struct accumulator
+    {
+        static constexpr bool bitmap = std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint32_t);
+
+        std::conditional_t<bitmap, RoaringBitmap, std::unordered_set<T>> seen;
+
+        void accumulate(T const &t)
+        {
+            if constexpr (bitmap)
+                seen.add(static_cast<std::uint32_t>(t));
+            else
+                seen.insert(t);
+        }
+
+        std::uint64_t result() const
+        {
+            if constexpr (bitmap)
+                return seen.cardinality();
+            else
+                return seen.size();
+        }
+
+        void merge(accumulator const &other)
+        {
+            if constexpr (bitmap)
+                seen |= other.seen;
+            else
+                seen.insert(other.seen.begin(), other.seen.end());
+        }
+    };
+
+    template <typename T>
+    accumulator<T> bind() const { return {}; }
+};
+
+inline BitmapAggregator toBitmap() { return {}; }
+
+inline CountDistinctAggregator countDistinct() { return {}; }
+
+template <typename CRTP>
+class Stream
+{
+  private:
+    auto &impl() { return *static_cast<CRTP *>(this); }
+    auto next() { return impl().next(); }
+
+    // Consumes a parallel stream and returns an element satisfying f: the first one in encounter
+    // order if `first`, else whichever is found first. Ranges give up once a witness at a lower
+    // index (or, for `first == false`, any witness) has been published.
+    template <typename F>
+    auto parallelFind(F &&f, bool first)
+    {
+        std::size_t n = impl().size();
+        std::atomic<std::size_t> found{n};
+        detail::parallelRanges(impl().executor(), n, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++)
+            {
+                std::size_t best = found.load(std::memory_order_relaxed);
+                if (first ? best <= i : best != n)
+                    return;
+                decltype(auto) t = impl().at(i);
+                if (f(t))
+                {
+                    while (i < best && !found.compare_exchange_weak(best, i, std::memory_order_relaxed))
+                        ;
+                    return;
+                }
+            }
+        });
+        std::optional<typename CRTP::value_type> ret;
+        if (std::size_t i = found.load(); i < n)
+            ret.emplace(impl().at(i));
+        impl().skip(n);
+        return ret;
+    }
+
+  public:
+    using base_type = Stream<CRTP>;
+
+    template <typename F>
+    constexpr auto filter(F &&f) { return FilterStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+
+    // filter(f1).filter(f2)... with the predicates reordered at run time by observed cost and
+    // selectivity, unless fixedOrder is passed first.
+    template <typename... F>
+    constexpr auto adaptiveFilters(F &&...f) { return AdaptiveFilterStream<CRTP, true, F...>{impl(), std::forward<F>(f)...}; }
+
+    template <typename... F>
+    constexpr auto adaptiveFilters(fixed_order_t, F &&...f) { return AdaptiveFilterStream<CRTP, false, F...>{impl(), std::forward<F>(f)...}; }
+
+    template <typename F>
+    constexpr auto map(F &&f) { return TransformStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+
+    template <typename F>
+    constexpr auto flatMap(F &&f) { return FlatStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+
+    template<typename F>
+    constexpr auto peek(F &&f) { return PeekStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+
+    constexpr auto limit(std::size_t n) { return LimitStream<CRTP>{impl(), n}; };
+
+    // Inner joins yield pair<left const &, right const &>, left joins pair<left const &, right const *>
+    // with null for unmatched rows, semi and anti joins the left elements themselves.
+    template <typename O, typename LK, typename RK, JoinKind Kind = JoinKind::inner>
+    constexpr auto hashJoin(O &&other, LK &&leftKey, RK &&rightKey, join_t<Kind> = {})
+    {
+        return HashJoinStream<CRTP, std::remove_reference_t<O>, LK, RK, Kind>{impl(), other, std::forward<LK>(leftKey), std::forward<RK>(rightKey)};
+    }
+
+    template <typename F>
+    constexpr auto takeWhile(F &&f) { return TakeWhileStream<CRTP, F, false>{impl(), std::forward<F>(f)}; }
+
+    template <typename F>
+    constexpr auto takeWhile(F &&f, monotonic_t) { return TakeWhileStream<CRTP, F, true>{impl(), std::forward<F>(f)}; }
+
+    template <typename F>
+    constexpr auto dropWhile(F &&f) { return DropWhileStream<CRTP, F, false>{impl(), std::forward<F>(f)}; }
+
+    template <typename F>
+    constexpr auto dropWhile(F &&f, monotonic_t) { return DropWhileStream<CRTP, F, true>{impl(), std::forward<F>(f)}; }
+
+    // Sorts the whole stream by cmp. Arithmetic elements in the default order are radix sorted,
+    // with parallel MSD passes on parallel() streams.
+    template <typename Cmp = std::less<>>
+    auto sort(Cmp cmp = {})
+    {
+        using value_type = typename CRTP::value_type;
+        if constexpr (std::is_same_v<Cmp, std::less<>> && detail::RadixKey<value_type>)
+            return SortStream<CRTP, detail::KeySort<detail::Identity>, true>{impl(), {}};
+        else
+            return SortStream<CRTP, detail::ComparisonSort<Cmp>, std::is_same_v<Cmp, std::less<>>>{impl(), {cmp}};
+    }
+
+    // Stable sort by ascending key(element). Arithmetic keys are radix sorted on (key, index)
+    // pairs, with parallel MSD passes on parallel() streams.
+    template <typename K>
+    auto sortedByKey(K &&key) { return SortStream<CRTP, detail::KeySort<std::remove_cvref_t<K>>, false>{impl(), {std::forward<K>(key)}}; }
+
+    // Stable sort by cmp(key(a), key(b)) that calls key once per element rather than once per
+    // comparison. String keys compare on cached 8-byte prefixes before touching the full keys.
+    template <typename K, typename Cmp = std::less<>>
+    auto sortedBy(K &&key, Cmp cmp = {})
+    {
+        return SortStream<CRTP, detail::KeySort<std::remove_cvref_t<K>, Cmp>, false>{impl(), {std::forward<K>(key), cmp}};
+    }
+
+    // Running fold yielding op(init, x0), op(op(init, x0), x1), ... Over contiguous arithmetic
+    // streams the fold runs in vectorized blocks and over parallel() streams in two parallel
+    // passes; both regroup the operations, so op must be associative there.
+    template <typename Op, typename T>
+    constexpr auto scan(Op op, T init) { return inclusiveScan(op, init); }
+
+    template <typename Op, typename T>
+    constexpr auto inclusiveScan(Op op, T init) { return ScanStream<CRTP, T, Op, true>{impl(), op, init}; }
+
+    // Yields the fold before each element instead: init, op(init, x0), ...
+    template <typename Op, typename T>
+    constexpr auto exclusiveScan(Op op, T init) { return ScanStream<CRTP, T, Op, false>{impl(), op, init}; }
+
+    // Emits one (key, aggregate) pair per run of equal keys, holding a single group at a time.
+    template <typename K, typename A>
+    constexpr auto groupAdjacentBy(K &&key, A aggregator) { return GroupAdjacentStream<CRTP, K, A>{impl(), std::forward<K>(key), aggregator}; }
+
+    // Groups in a hash table and emits the groups once the input is drained, except for sorted
+    // streams grouped by std::identity, which are grouped per run like groupAdjacentBy.
+    template <typename K, typename A>
+    constexpr auto groupBy(K &&key, A aggregator)
+    {
+        if constexpr (SortedStream<CRTP> && std::is_same_v<std::remove_cvref_t<K>, std::identity>)
+            return groupAdjacentBy(std::forward<K>(key), aggregator);
+        else
+            return HashGroupStream<CRTP, K, A>{impl(), std::forward<K>(key), aggregator};
+    }
+
+    // Promises that equal keys are adjacent, e.g. a bucket of the sort key over sorted input, and
+    // groups per run with groupAdjacentBy.
+    template <typename K, typename A>
+    constexpr auto groupBy(K &&key, A aggregator, monotonic_t) { return groupAdjacentBy(std::forward<K>(key), aggregator); }
+
+    // Bounded variant: past memoryBudget bytes of groups, elements of new keys are hash partitioned
+    // to temporary files and grouped partition by partition afterwards.
+    template <typename K, typename A>
+    constexpr auto groupBy(K &&key, A aggregator, std::size_t memoryBudget)
+    {
+        static_assert(std::is_trivially_copyable_v<typename CRTP::value_type>, "spilled elements must be trivially copyable");
+        return HashGroupStream<CRTP, K, A>{impl(), std::forward<K>(key), aggregator, memoryBudget};
+    }
+
+    // Without a memory budget, integers of up to 32 bits are tracked in a RoaringBitmap rather
+    // than a hash set.
+    constexpr auto distinct() { return DistinctStream<CRTP>{impl()}; }
+
+    constexpr auto distinct(std::size_t memoryBudget)
+    {
+        static_assert(std::is_trivially_copyable_v<typename CRTP::value_type>, "spilled elements must be trivially copyable");
+        return DistinctStream<CRTP>{impl(), memoryBudget};
+    }
+
+    // Splits the stream into maximal runs where pred(previous, current) holds, yielded as spans.
+    template <typename P>
+    constexpr auto chunkBy(P &&pred) { return ChunkByStream<CRTP, P>{impl(), std::forward<P>(pred)}; }
+
+    // Moves everything upstream onto its own thread, handing elements over through a bounded
+    // lock-free queue of queueDepth elements published batchSize at a time.
+    auto async(std::size_t queueDepth = 1024, std::size_t batchSize = 64) { return AsyncStream<CRTP>{impl(), queueDepth, batchSize}; }
+
+    // Evaluates short-circuiting terminals (anyMatch, allMatch, noneMatch, findFirst(f),
+    // findAny(f)) in parallel on executor. map() keeps the binding, so its function must be safe
+    // to call concurrently; stages without random access, such as filter(), drop it.
+    auto parallel(Executor &executor = Executor::global()) requires RandomAccessStream<CRTP>
+    {
+        return ParallelSourceStream<CRTP>{impl(), executor};
+    }
+
+    // Maps on up to `threads` executor workers (default: all of them) keeping at most `window`
+    // elements in flight (default: four per thread); results keep encounter order unless
+    // .unordered() is used.
+    template <typename F>
+    auto parallelMap(F &&f, std::size_t threads = 0, std::size_t window = 0, Executor &executor = Executor::global())
+    {
+        return ParallelMapStream<CRTP, F, true>{impl(), std::forward<F>(f), threads, window, executor};
+    }
+
+    // Drains the stream into a Cache whose stream() can be replayed any number of times. With a
+    // spill threshold, trivially copyable contents beyond it go to a memory mapped temporary file.
+    auto cache(std::size_t spillBytes = -1) { return Cache<typename CRTP::value_type>{impl(), spillBytes}; }
+
+    // Uniform sample of k elements, emitted once the stream is drained; equal seeds give equal samples.
+    constexpr auto sample(std::size_t k, std::uint64_t seed = 0) { return SampleStream<CRTP>{impl(), k, seed}; }
+
+    // Keeps each element independently with probability p, preserving encounter order.
+    constexpr auto sampleFraction(double p, std::uint64_t seed = 0) { return SampleFractionStream<CRTP>{impl(), p, seed}; }
+
+    constexpr auto window(std::size_t size, std::size_t step = 1) { return WindowStream<CRTP>{impl(), size, step, false}; }
+
+    constexpr auto chunk(std::size_t n) { return WindowStream<CRTP>{impl(), n, n, true}; }
+
+    constexpr auto slidingSum(std::size_t size) { return SlidingSumStream<CRTP>{impl(), size}; }
+
+    constexpr auto slidingMin(std::size_t size) { return SlidingExtremumStream<CRTP, std::less<>>{impl(), size, {}}; }
+
+    constexpr auto slidingMax(std::size_t size) { return SlidingExtremumStream<CRTP, std::greater<>>{impl(), size, {}}; }
+
+    template <typename F>
+    constexpr void forEach(F &&f)
+    {
+        if constexpr (RandomAccessStream<CRTP>)
+        {
+            // at() may return a prvalue; naming it keeps f seeing lvalues, as with *next().
+            std::size_t n = impl().size();
+            for (std::size_t i = 0; i < n; i++)
+            {
+                decltype(auto) t = impl().at(i);
+                f(t);
+            }
+            impl().skip(n);
+        }
+        else
+        {
+            while (!empty())
+                std::forward<F>(f)(*next());
+        }
+    }
+
+    constexpr std::size_t count()
+    {
+        if constexpr (RandomAccessStream<CRTP>)
+        {
+            std::size_t count = impl().size();
+            impl().skip(count);
+            return count;
+        }
+        std::size_t count = 0;
+        while (!empty())
+        {
+            count++;
+            next();
+        }
+        return count;
+    }
+
+    constexpr auto sum()
+    {
+        using value_type = typename CRTP::value_type;
+        if constexpr (RandomAccessStream<CRTP> && std::is_arithmetic_v<value_type>)
+        {
+            // Independent lanes let the compiler vectorize the reduction, floating point included.
+            constexpr std::size_t lanes = 8;
+            value_type partial[lanes]{};
+            std::size_t n = impl().size(), i = 0;
+            for (; i + lanes <= n; i += lanes)
+                for (std::size_t l = 0; l < lanes; l++)
+                    partial[l] += impl().at(i + l);
+            for (; i < n; i++)
+                partial[0] += impl().at(i);
+            impl().skip(n);
+            value_type sum{};
+            for (auto p : partial)
+                sum += p;
+            return sum;
+        }
+        else
+        {
+            value_type sum{};
+            while (!empty())
+                sum += *next();
+            return sum;
+        }
+    }
+
+    // Feeds every element to a fresh accumulator of the aggregator and returns its result.
+    template <typename A>
+    constexpr auto collect(A aggregator)
+    {
+        auto accumulator = aggregator.template bind<typename CRTP::value_type>();
+        while (!empty())
+            accumulator.accumulate(*next());
+        return accumulator.result();
+    }
+
+    // Drives the stream once, feeding each element to one accumulator per aggregator, and returns
+    // their results as a tuple. Finished short-circuiting accumulators are skipped; traversal ends
+    // early only when every accumulator is done.
+    template <typename... A>
+    constexpr auto aggregate(A... aggregators)
+    {
+        using value_type = typename CRTP::value_type;
+        std::tuple accumulators{aggregators.template bind<value_type>()...};
+        auto feed = [](auto &accumulator, value_type const &element) {
+            if constexpr (ShortCircuitAccumulator<std::remove_cvref_t<decltype(accumulator)>>)
+            {
+                if (!accumulator.done())
+                    accumulator.accumulate(element);
+            }
+            else
+                accumulator.accumulate(element);
+        };
+        auto done = [](auto const &accumulator) {
+            if constexpr (ShortCircuitAccumulator<std::remove_cvref_t<decltype(accumulator)>>)
+                return accumulator.done();
+            else
+                return false;
+        };
+        while (!empty())
+        {
+            auto const &element = *next();
+            std::apply([&](auto &...accumulator) { (feed(accumulator, element), ...); }, accumulators);
+            if (std::apply([&](auto const &...accumulator) { return (done(accumulator) && ...); }, accumulators))
+            {
+                detail::cancel(impl());
+                break;
+            }
+        }
+        return std::apply([](auto const &...accumulator) { return std::tuple{accumulator.result()...}; }, accumulators);
+    }
+
+    // Writes a stream of tuples of arithmetic fields as a column file (see ColumnFileWriter).
+    void writeColumns(std::ostream &out, std::size_t chunkRows = 65536)
+    {
+        [&]<typename... T>(std::type_identity<std::tuple<T...>>) {
+            ColumnFileWriter<std::remove_cvref_t<T>...> writer(out, chunkRows);
+            while (!empty())
+                std::apply([&](auto const &...field) { writer.append(field...); }, *next());
+            writer.close();
+        }(std::type_identity<typename CRTP::value_type>{});
+    }
+
+    auto collectToBitmap() { return collect(jstream::toBitmap()); }
+
+    auto countDistinct() { return collect(jstream::countDistinct()); }
+
+    auto approxCountDistinct(int precision = 14) { return collect(jstream::approxCountDistinct(precision)); }
+
+    auto approxQuantiles(double eps = 0.01) { return collect(jstream::approxQuantiles(eps)); }
+
+    auto heavyHitters(std::size_t k = 10) { return collect(jstream::heavyHitters(k)); }
+
+    constexpr auto summaryStatistics()
+    {
+        using value_type = typename CRTP::value_type;
+        SummaryStatistics<value_type> stats;
+        if constexpr (ContiguousStream<CRTP> && std::is_arithmetic_v<value_type>)
+        {
+            std::size_t n = impl().size();
+            stats.accumulate(std::span<value_type const>{impl().data(), n});
+            impl().skip(n);
+        }
+        else if constexpr (RandomAccessStream<CRTP> && std::is_arithmetic_v<value_type>)
+        {
+            constexpr std::size_t block = 256;
+            value_type buffer[block];
+            for (std::size_t n = impl().size(); n > 0; n = impl().size())
+            {
+                n = std::min(n, block);
+                for (std::size_t i = 0; i < n; i++)
+                    buffer[i] = impl().at(i);
+                stats.accumulate(std::span<value_type const>{buffer, n});
+                impl().skip(n);
+            }
+        }
+        else
+        {
+            while (!empty())
+                stats.accumulate(*next());
+        }
+        return stats;
+    }
+
+    template <typename F>
+    constexpr bool allMatch(F &&f)
+    {
+        return !anyMatch([&](auto const &t) { return !f(t); });
+    }
+
+    template <typename F>
+    constexpr bool anyMatch(F &&f)
+    {
+        if constexpr (ParallelStream<CRTP>)
+            return parallelFind(f, false).has_value();
+        else
+        {
+            while (!empty())
+                if (f(*next()))
+                {
+                    detail::cancel(impl());
+                    return true;
+                }
+            return false;
+        }
+    }
+
+    template <typename F>
+    constexpr bool noneMatch(F &&f) { return !anyMatch(f); }
+
+    constexpr auto findFirst()
+    {
+        std::optional<typename CRTP::value_type> ret;
+        if (!empty())
+        {
+            ret.emplace(*next());
+            detail::cancel(impl());
+        }
+        return ret;
+    }
+
+    // First element satisfying f in encounter order, also on parallel streams.
+    template <typename F>
+    constexpr auto findFirst(F &&f)
+    {
+        if constexpr (ParallelStream<CRTP>)
+            return parallelFind(f, true);
+        else
+        {
+            std::optional<typename CRTP::value_type> ret;
+            while (!ret && !empty())
+                if (auto const &t = *next(); f(t))
+                    ret.emplace(t);
+            if (ret)
+                detail::cancel(impl());
+            return ret;
+        }
+    }
+
+    constexpr auto findAny() { return findFirst(); }
+
+    // Some element satisfying f; on parallel streams whichever range finds one first.
+    template <typename F>
+    constexpr auto findAny(F &&f)
+    {
+        if constexpr (ParallelStream<CRTP>)
+            return parallelFind(f, false);
+        else
+            return findFirst(f);
+    }
+
+    constexpr bool empty() {
+        return impl().empty();
+    }
+};
+
+template <typename S, typename F>
+class FilterStream : public Stream<FilterStream<S, F>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr FilterStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        next_type ret = nullptr;
+        std::swap(ret, _next);
+        return ret;
+    }
+
+    constexpr bool empty() {
+        if (_next)
+            return false;
+        while (!_stream.empty()) {
+            _next = _stream.next();
+            if (_f(*_next))
+                return false;
+        }
+        _next = nullptr;
+        return true;
+    }
+
+    template <typename K, typename Cmp = std::less<>>
+        requires SeekableStream<S, K, Cmp>
+    constexpr void skipTo(K const &key, Cmp cmp = {})
+    {
+        if (_next && !cmp(*_next, key))
+            return;
+        _next = nullptr;
+        detail::skipTo(_stream, key, cmp);
+    }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+  private:
+    S &_stream;
+    F _f;
+    next_type _next = nullptr;
+};
+
+// Conjunction of predicates whose evaluation order adapts to the data. Every 64th element runs
+// all of them under a clock to estimate each one's cost and pass rate; every 4096 elements they
+// are reordered by cost / (1 - pass rate), which minimises the expected cost per element for
+// independent predicates, and the estimates decay by half so the order can follow drifting data.
+// Predicates must not depend on being called or on their order, unless Adaptive is false, which
+// keeps the order as written.
+template <typename S, bool Adaptive, typename... F>
+class AdaptiveFilterStream : public Stream<AdaptiveFilterStream<S, Adaptive, F...>>
+{
+    static constexpr std::size_t filters = sizeof...(F);
+    static constexpr std::size_t sampleEvery = 64;
+    static constexpr std::size_t reorderEvery = 4096;
+
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr AdaptiveFilterStream(S &s, F... f) : _stream(s), _filters(f...)
+    {
+        for (std::size_t i = 0; i < filters; i++)
+            _order[i] = i;
+    }
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        next_type ret = nullptr;
+        std::swap(ret, _next);
+        return ret;
+    }
+
+    constexpr bool empty()
+    {
+        if (_next)
+            return false;
+        while (!_stream.empty())
+        {
+            _next = _stream.next();
+            if (pass(*_next))
+                return false;
+        }
+        _next = nullptr;
+        return true;
+    }
+
+    // Indices of the predicates in their current evaluation order.
+    constexpr std::array<std::size_t, filters> const &order() const { return _order; }
+
+  private:
+    struct Estimate
+    {
+        double nanos = 0;
+        double calls = 0;
+        double passed = 0;
+    };
+
+    constexpr bool test(std::size_t i, value_type const &t)
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            bool ret = false;
+            ((I == i && (ret = static_cast<bool>(std::get<I>(_filters)(t)), true)) || ...);
+            return ret;
+        }(std::index_sequence_for<F...>{});
+    }
+
+    constexpr bool pass(value_type const &t)
+    {
+        if (!Adaptive || std::is_constant_evaluated() || _seen++ % sampleEvery)
+        {
+            for (std::size_t i : _order)
+                if (!test(i, t))
+                    return false;
+            return true;
+        }
+        bool ret = true;
+        for (std::size_t i = 0; i < filters; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool passed = test(i, t);
+            _estimates[i].nanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            _estimates[i].calls++;
+            _estimates[i].passed += passed;
+            ret &= passed;
+        }
+        if (_seen >= reorderEvery)
+            reorder();
+        return ret;
+    }
+
+    void reorder()
+    {
+        std::array<double, filters> rank;
+        for (std::size_t i = 0; i < filters; i++)
+        {
+            Estimate &e = _estimates[i];
+            rank[i] = e.calls ? (e.nanos / e.calls) / std::max(1 - e.passed / e.calls, 1e-3) : 0;
+            e = {e.nanos / 2, e.calls / 2, e.passed / 2};
+        }
+        std::stable_sort(_order.begin(), _order.end(), [&](std::size_t a, std::size_t b) { return rank[a] < rank[b]; });
+        _seen = 0;
+    }
+
+    S &_stream;
+    std::tuple<F...> _filters;
+    std::array<std::size_t, filters> _order;
+    std::array<Estimate, filters> _estimates{};
+    std::size_t _seen = 0;
+    next_type _next = nullptr;
+};
+
+template <typename S, typename F>
+class TransformStream : public Stream<TransformStream<S, F>>
+{
+  public:
+    using next_type = std::invoke_result_t<F, decltype(* typename S::next_type{})> *;
+    using value_type = std::remove_cv_t<std::remove_pointer_t<next_type>>;
+
+    constexpr TransformStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next()
+    {
+        if (!empty()) {
+            _currentElement = _f(*_stream.next());
+            return &_currentElement;
+        } else {
+            return nullptr;
+        }
+    }
+
+    constexpr bool empty() { return _stream.empty(); }
+
+    constexpr std::size_t size() requires RandomAccessStream<S> { return _stream.size(); }
+    constexpr decltype(auto) at(std::size_t i) requires RandomAccessStream<S> { return _f(_stream.at(i)); }
+    constexpr void skip(std::size_t n) requires RandomAccessStream<S> { _stream.skip(n); }
+
+    Executor &executor() requires ParallelStream<S> { return _stream.executor(); }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+  private:
+    S &_stream;
+    F _f;
+    value_type _currentElement{};
+};
+
+template <typename S, typename F>
+class FlatStream : public Stream<FlatStream<S, F>>
+{
+  public:
+    using substream_next_type = std::invoke_result_t<decltype(&S::next), S*>;
+    using flat_stream_type = std::invoke_result_t<F, decltype(*substream_next_type{})>;
+    using next_type = std::invoke_result_t<decltype(&flat_stream_type::next), flat_stream_type*>;
+    using value_type = std::remove_cv_t<std::remove_pointer_t<next_type>>;
+
+    constexpr FlatStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next()
+    {
+        return empty() ? nullptr : _currentFlatStream->next();
+    }
+
+    constexpr bool empty()
+    {
+        while (!_currentFlatStream || _currentFlatStream->empty())
+        {
+            if (_stream.empty())
+                return true;
+            _currentFlatStream.emplace(_f(*_stream.next()));
+        }
+        return false;
+    }
+
+  private:
+    S &_stream;
+    F _f;
+    std::optional<flat_stream_type> _currentFlatStream;
+};
+
+template<typename S, typename F>
+class PeekStream : public Stream<PeekStream<S, F>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr PeekStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next() {
+        next_type n = _stream.next();
+        if (n)
+            _f(*n);
+        return n;
+    }
+
+    constexpr bool empty() { return _stream.empty(); }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+  private:
+    S &_stream;
+    F _f;
+};
+
+template <typename S>
+class LimitStream : public Stream<LimitStream<S>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr LimitStream(S &s, std::size_t n) : _stream(s), _n(n) {}
+
+    constexpr next_type next()
+    {
+        if (_n > 0 && !_stream.empty())
+        {
+            next_type ret = _stream.next();
+            if (--_n == 0)
+                detail::cancel(_stream);
+            return ret;
+        }
+        return nullptr;
+    }
+
+    constexpr bool empty() { return _n <= 0 || _stream.empty(); }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+    constexpr std::size_t size() requires RandomAccessStream<S> { return std::min(_n, _stream.size()); }
+    constexpr decltype(auto) at(std::size_t i) requires RandomAccessStream<S> { return _stream.at(i); }
+    constexpr void skip(std::size_t n) requires RandomAccessStream<S>
+    {
+        n = std::min(n, size());
+        _stream.skip(n);
+        _n -= n;
+    }
+
+  private:
+    S &_stream;
+    std::size_t _n;
+};
+
+template <typename... S>
+class ZipStream : public Stream<ZipStream<S...>>
+{
+  public:
+    using value_type = std::tuple<decltype(*typename S::next_type{})...>;
+    using next_type = value_type *;
+
+    constexpr ZipStream(S &...s) : _streams(s...) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        std::apply([this](auto &...s) { _currentElement.emplace(*s.next()...); }, _streams);
+        return &*_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        return std::apply([](auto &...s) { return (s.empty() || ...); }, _streams);
+    }
+
+    constexpr std::size_t size() requires (RandomAccessStream<S> && ...)
+    {
+        return std::apply([](auto &...s) { return std::min({static_cast<std::size_t>(s.size())...}); }, _streams);
+    }
+
+    constexpr auto at(std::size_t i) requires (RandomAccessStream<S> && ...)
+    {
+        return std::apply([i](auto &...s) { return std::tuple<decltype(s.at(i))...>{s.at(i)...}; }, _streams);
+    }
+
+    constexpr void skip(std::size_t n) requires (RandomAccessStream<S> && ...)
+    {
+        std::apply([n](auto &...s) { (s.skip(n), ...); }, _streams);
+    }
+
+  private:
+    std::tuple<S &...> _streams;
+    std::optional<value_type> _currentElement;
+};
+
+template <typename F, typename... S>
+class ZipWithStream : public Stream<ZipWithStream<F, S...>>
+{
+  public:
+    using next_type = std::invoke_result_t<F, decltype(*typename S::next_type{})...> *;
+    using value_type = std::remove_cv_t<std::remove_pointer_t<next_type>>;
+
+    constexpr ZipWithStream(F f, S &...s) : _f(f), _streams(s...) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _currentElement = std::apply([this](auto &...s) { return _f(*s.next()...); }, _streams);
+        return &_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        return std::apply([](auto &...s) { return (s.empty() || ...); }, _streams);
+    }
+
+    constexpr std::size_t size() requires (RandomAccessStream<S> && ...)
+    {
+        return std::apply([](auto &...s) { return std::min({static_cast<std::size_t>(s.size())...}); }, _streams);
+    }
+
+    constexpr decltype(auto) at(std::size_t i) requires (RandomAccessStream<S> && ...)
+    {
+        return std::apply([this, i](auto &...s) -> decltype(auto) { return _f(s.at(i)...); }, _streams);
+    }
+
+    constexpr void skip(std::size_t n) requires (RandomAccessStream<S> && ...)
+    {
+        std::apply([n](auto &...s) { (s.skip(n), ...); }, _streams);
+    }
+
+  private:
+    F _f;
+    std::tuple<S &...> _streams;
+    value_type _currentElement;
+};
+
+template <typename S, typename F, bool Monotonic>
+class TakeWhileStream : public Stream<TakeWhileStream<S, F, Monotonic>>
+{
+    static constexpr bool bounded = Monotonic && RandomAccessStream<S>;
+
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr TakeWhileStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        if constexpr (bounded)
+        {
+            _n--;
+            return _stream.next();
+        }
+        next_type ret = nullptr;
+        std::swap(ret, _next);
+        return ret;
+    }
+
+    constexpr bool empty()
+    {
+        if constexpr (bounded)
+            return size() == 0;
+        if (_next)
+            return false;
+        if (_done || _stream.empty())
+            return true;
+        _next = _stream.next();
+        if (_f(*_next))
+            return false;
+        _next = nullptr;
+        _done = true;
+        detail::cancel(_stream);
+        return true;
+    }
+
+    constexpr std::size_t size() requires bounded
+    {
+        if (!_done)
+        {
+            _n = detail::partitionPoint(_stream, _f);
+            _done = true;
+        }
+        return _n;
+    }
+
+    constexpr decltype(auto) at(std::size_t i) requires bounded { return _stream.at(i); }
+
+    constexpr void skip(std::size_t n) requires bounded
+    {
+        n = std::min(n, size());
+        _stream.skip(n);
+        _n -= n;
+    }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+  private:
+    S &_stream;
+    F _f;
+    next_type _next = nullptr;
+    bool _done = false;
+    std::size_t _n = 0;
+};
+
+template <typename S, typename F, bool Monotonic>
+class DropWhileStream : public Stream<DropWhileStream<S, F, Monotonic>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr DropWhileStream(S &s, F f) : _stream(s), _f(f) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        if (_next)
+        {
+            next_type ret = nullptr;
+            std::swap(ret, _next);
+            return ret;
+        }
+        return _stream.next();
+    }
+
+    constexpr bool empty()
+    {
+        drop();
+        return !_next && _stream.empty();
+    }
+
+    constexpr std::size_t size() requires RandomAccessStream<S>
+    {
+        drop();
+        return _stream.size();
+    }
+
+    constexpr decltype(auto) at(std::size_t i) requires RandomAccessStream<S>
+    {
+        drop();
+        return _stream.at(i);
+    }
+
+    constexpr void skip(std::size_t n) requires RandomAccessStream<S>
+    {
+        drop();
+        _stream.skip(n);
+    }
+
+    constexpr void cancel() { detail::cancel(_stream); }
+
+  private:
+    constexpr void drop()
+    {
+        if (_dropped)
+            return;
+        _dropped = true;
+        if constexpr (RandomAccessStream<S>)
+        {
+            std::size_t n = 0;
+            if constexpr (Monotonic)
+                n = detail::partitionPoint(_stream, _f);
+            else
+                for (std::size_t size = _stream.size(); n < size && _f(_stream.at(n)); n++)
+                    ;
+            _stream.skip(n);
+        }
+        else
+        {
+            while (!_stream.empty())
+            {
+                _next = _stream.next();
+                if (!_f(*_next))
+                    return;
+            }
+            _next = nullptr;
+        }
+    }
+
+    S &_stream;
+    F _f;
+    next_type _next = nullptr;
+    bool _dropped = false;
+};
+
+template <typename S, typename K, typename A>
+class GroupAdjacentStream : public Stream<GroupAdjacentStream<S, K, A>>
+{
+    using key_type = std::remove_cvref_t<std::invoke_result_t<K &, typename S::value_type const &>>;
+    using accumulator_type = accumulator_t<A, typename S::value_type>;
+
+  public:
+    using value_type = std::pair<key_type const &, decltype(std::declval<accumulator_type const &>().result())>;
+    using next_type = value_type *;
+    // Runs of a sorted stream only come out in key order when the key is the element itself.
+    static constexpr bool sorted = SortedStream<S> && std::is_same_v<std::remove_cvref_t<K>, std::identity>;
+
+    constexpr GroupAdjacentStream(S &s, K key, A aggregator) : _stream(s), _key(key), _aggregator(aggregator) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _ready = false;
+        return &*_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        if (_ready)
+            return false;
+        if (!_group && _stream.empty())
+            return true;
+        if (!_group)
+            start(*_stream.next());
+        while (!_stream.empty())
+        {
+            auto const &element = *_stream.next();
+            if (!(_key(element) == _group->first))
+            {
+                emit();
+                start(element);
+                return !(_ready = true);
+            }
+            _group->second.accumulate(element);
+        }
+        emit();
+        _group.reset();
+        return !(_ready = true);
+    }
+
+  private:
+    // The emitted key outlives its group, so the pair can refer to it as HashGroupStream's do.
+    constexpr void emit()
+    {
+        _currentElement.reset();
+        _emittedKey.emplace(std::move(_group->first));
+        _currentElement.emplace(*_emittedKey, _group->second.result());
+    }
+
+    constexpr void start(typename S::value_type const &element)
+    {
+        _group.emplace(_key(element), _aggregator.template bind<typename S::value_type>());
+        _group->second.accumulate(element);
+    }
+
+    S &_stream;
+    K _key;
+    A _aggregator;
+    bool _ready = false;
+    std::optional<std::pair<key_type, accumulator_type>> _group;
+    std::optional<key_type> _emittedKey;
+    std::optional<value_type> _currentElement;
+};
+
+template <typename S, typename K, typename A>
+class HashGroupStream : public Stream<HashGroupStream<S, K, A>>
+{
+    using element_type = typename S::value_type;
+    using key_type = std::remove_cvref_t<std::invoke_result_t<K &, element_type const &>>;
+    using accumulator_type = accumulator_t<A, element_type>;
+    using map_type = std::unordered_map<key_type, accumulator_type>;
+
+  public:
+    using value_type = std::pair<key_type const &, decltype(std::declval<accumulator_type const &>().result())>;
+    using next_type = value_type *;
+
+    constexpr HashGroupStream(S &s, K key, A aggregator, std::size_t memoryBudget = -1)
+        : _stream(s), _key(key), _aggregator(aggregator), _budget(memoryBudget) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _currentElement.emplace(_position->first, _position->second.result());
+        ++_position;
+        return &*_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        if (!_started)
+        {
+            _started = true;
+            detail::Partitions<element_type> spilled(0);
+            while (!_stream.empty())
+                add(*_stream.next(), spilled);
+            spilled.moveTo(_pending);
+            _position = _groups.begin();
+        }
+        if constexpr (std::is_trivially_copyable_v<element_type>)
+        {
+            while (_position == _groups.end() && !_pending.empty())
+            {
+                auto [file, depth] = std::move(_pending.back());
+                _pending.pop_back();
+                _groups.clear();
+                detail::Partitions<element_type> spilled(depth);
+                element_type element;
+                for (file->rewind(); file->read(element);)
+                    add(element, spilled);
+                spilled.moveTo(_pending);
+                _position = _groups.begin();
+            }
+        }
+        return _position == _groups.end();
+    }
+
+  private:
+    // Keys already in the table keep aggregating in memory; once the budget is used up, elements
+    // of new keys are hash partitioned to spill files and grouped after the table is drained.
+    constexpr void add(element_type const &element, detail::Partitions<element_type> &spilled)
+    {
+        key_type key = _key(element);
+        auto it = _groups.find(key);
+        if (it == _groups.end())
+        {
+            if constexpr (std::is_trivially_copyable_v<element_type>)
+                if (spilled.spill(_groups.size() * detail::nodeBytes<typename map_type::value_type>, _budget))
+                    return spilled.add(detail::hash(key), element);
+            it = _groups.emplace(std::move(key), _aggregator.template bind<element_type>()).first;
+        }
+        it->second.accumulate(element);
+    }
+
+    S &_stream;
+    K _key;
+    A _aggregator;
+    std::size_t _budget;
+    bool _started = false;
+    map_type _groups;
+    typename map_type::iterator _position;
+    typename detail::Partitions<element_type>::pending_type _pending;
+    std::optional<value_type> _currentElement;
+};
+
+template <typename S>
+class DistinctStream : public Stream<DistinctStream<S>>
+{
+    static constexpr bool bitmap = std::is_integral_v<typename S::value_type> && sizeof(typename S::value_type) <= sizeof(std::uint32_t);
+
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type const *;
+
+    constexpr DistinctStream(S &s, std::size_t memoryBudget = -1) : _stream(s), _budget(memoryBudget), _spilled(0) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        next_type ret = nullptr;
+        std::swap(ret, _next);
+        return ret;
+    }
+
+    constexpr bool empty()
+    {
+        while (!_next)
+        {
+            if (!_file)
+            {
+                if (!_stream.empty())
+                {
+                    add(*_stream.next());
+                    continue;
+                }
+                if constexpr (!std::is_trivially_copyable_v<value_type>)
+                    return true;
+            }
+            if constexpr (std::is_trivially_copyable_v<value_type>)
+            {
+                value_type element;
+                if (_file && _file->read(element))
+                {
+                    add(element);
+                    continue;
+                }
+                _spilled.moveTo(_pending);
+                if (_pending.empty())
+                    return true;
+                std::size_t depth;
+                std::tie(_file, depth) = std::move(_pending.back());
+                _pending.pop_back();
+                _file->rewind();
+                _seen.clear();
+                _spilled = detail::Partitions<value_type>(depth);
+            }
+        }
+        return false;
+    }
+
+  private:
+    constexpr void add(value_type const &element)
+    {
+        if constexpr (bitmap)
+            if (_budget == std::size_t(-1))
+            {
+                std::uint32_t key = static_cast<std::uint32_t>(element);
+                if (_bitmap.contains(key))
+                    return;
+                _bitmap.add(key);
+                _currentElement = element;
+                _next = &_currentElement;
+                return;
+            }
+        if (_seen.contains(element))
+            return;
+        if constexpr (std::is_trivially_copyable_v<value_type>)
+            if (_spilled.spill(_seen.size() * detail::nodeBytes<value_type>, _budget))
+                return _spilled.add(detail::hash(element), element);
+        _next = &*_seen.insert(element).first;
+    }
+
+    S &_stream;
+    std::size_t _budget;
+    std::unordered_set<value_type> _seen;
+    std::conditional_t<bitmap, RoaringBitmap, std::monostate> _bitmap;
+    std::conditional_t<bitmap, value_type, std::monostate> _currentElement{};
+    next_type _next = nullptr;
+    detail::Partitions<value_type> _spilled;
+    typename detail::Partitions<value_type>::pending_type _pending;
+    typename detail::Partitions<value_type>::file_type _file;
+};
+
+template <typename S, typename P>
+class ChunkByStream : public Stream<ChunkByStream<S, P>>
+{
+  public:
+    using value_type = std::span<typename S::value_type const>;
+    using next_type = value_type *;
+
+    constexpr ChunkByStream(S &s, P pred) : _stream(s), _pred(pred) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        if constexpr (ContiguousStream<S>)
+            _stream.skip(_currentElement.size());
+        _ready = false;
+        return &_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        if (_ready)
+            return false;
+        if constexpr (ContiguousStream<S>)
+        {
+            std::size_t n = _stream.size(), i = 1;
+            if (n == 0)
+                return true;
+            for (; i < n && _pred(_stream.at(i - 1), _stream.at(i)); i++)
+                ;
+            _currentElement = value_type{_stream.data(), i};
+            return !(_ready = true);
+        }
+        else
+        {
+            if (_pending)
+                _buffer.assign(1, std::move(*_pending));
+            else if (_stream.empty())
+                return true;
+            else
+                _buffer.assign(1, *_stream.next());
+            _pending.reset();
+            while (!_stream.empty())
+            {
+                auto const &element = *_stream.next();
+                if (!_pred(_buffer.back(), element))
+                {
+                    _pending = element;
+                    break;
+                }
+                _buffer.push_back(element);
+            }
+            _currentElement = value_type{_buffer};
+            return !(_ready = true);
+        }
+    }
+
+  private:
+    S &_stream;
+    P _pred;
+    bool _ready = false;
+    std::vector<typename S::value_type> _buffer;
+    std::optional<typename S::value_type> _pending;
+    value_type _currentElement;
+};
+
+// Reservoir sampling with Li's Algorithm L: after the reservoir fills, the number of elements to
+// pass over before the next replacement is drawn directly, so random numbers are only generated
+// per replacement and random access sources skip the gaps without reading them.
+template <typename S>
+class SampleStream : public Stream<SampleStream<S>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type const *;
+
+    constexpr SampleStream(S &s, std::size_t k, std::uint64_t seed) : _stream(s), _k(k), _random(seed) {}
+
+    constexpr next_type next() { return empty() ? nullptr : &_reservoir[_position++]; }
+
+    constexpr bool empty()
+    {
+        if (!_started)
+        {
+            _started = true;
+            fill();
+        }
+        return _position == _reservoir.size();
+    }
+
+  private:
+    constexpr void fill()
+    {
+        if (_k == 0)
+            return;
+        _reservoir.reserve(_k);
+        while (_reservoir.size() < _k && !_stream.empty())
+            _reservoir.push_back(*_stream.next());
+        double w = std::exp(std::log(_random.uniform()) / _k);
+        while (true)
+        {
+            double gap = std::floor(std::log(_random.uniform()) / std::log1p(-w));
+            if (!pass(gap < 1e18 ? static_cast<std::uint64_t>(gap) : std::uint64_t(-1)))
+                return;
+            _reservoir[_random() % _k] = *_stream.next();
+            w *= std::exp(std::log(_random.uniform()) / _k);
+        }
+    }
+
+    // Drops n elements and reports whether one more is available.
+    constexpr bool pass(std::uint64_t n)
+    {
+        if constexpr (RandomAccessStream<S>)
+        {
+            if (n >= _stream.size())
+            {
+                _stream.skip(_stream.size());
+                return false;
+            }
+            _stream.skip(n);
+        }
+        else
+            for (; n > 0 && !_stream.empty(); n--)
+                _stream.next();
+        return !_stream.empty();
+    }
+
+    S &_stream;
+    std::size_t _k;
+    detail::SplitMix _random;
+    bool _started = false;
+    std::vector<value_type> _reservoir;
+    std::size_t _position = 0;
+};
+
+// Bernoulli sampling: the gap to the next kept element is geometric, drawn in one step.
+template <typename S>
+class SampleFractionStream : public Stream<SampleFractionStream<S>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    constexpr SampleFractionStream(S &s, double p, std::uint64_t seed) : _stream(s), _p(p), _random(seed) {}
+
+    constexpr next_type next() { return empty() ? nullptr : (_ready = false, _stream.next()); }
+
+    constexpr bool empty()
+    {
+        if (_ready)
+            return false;
+        if (_p <= 0)
+            return true;
+        double gap = _p >= 1 ? 0 : std::floor(std::log(_random.uniform()) / std::log1p(-_p));
+        std::uint64_t n = gap < 1e18 ? static_cast<std::uint64_t>(gap) : std::uint64_t(-1);
+        if constexpr (RandomAccessStream<S>)
+            _stream.skip(std::min<std::uint64_t>(n, _stream.size()));
+        else
+            for (; n > 0 && !_stream.empty(); n--)
+                _stream.next();
+        return !(_ready = !_stream.empty());
+    }
+
+  private:
+    S &_stream;
+    double _p;
+    detail::SplitMix _random;
+    bool _ready = false;
+};
+
+template <typename T>
+class CacheStream : public Stream<CacheStream<T>>
+{
+  public:
+    using value_type = T;
+    using next_type = T const *;
+
+    constexpr CacheStream(T const *const *chunks, std::size_t size, int shift) : _chunks(chunks), _size(size), _shift(shift) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        next_type n = &at(0);
+        _position++;
+        return n;
+    }
+
+    constexpr bool empty() { return _position == _size; }
+
+    constexpr std::size_t size() { return _size - _position; }
+
+    constexpr T const &at(std::size_t i)
+    {
+        std::size_t index = _position + i;
+        return _chunks[index >> _shift][index & ((std::size_t{1} << _shift) - 1)];
+    }
+
+    constexpr void skip(std::size_t n) { _position += std::min(n, size()); }
+
+  private:
+    T const *const *_chunks;
+    std::size_t _size;
+    int _shift;
+    std::size_t _position = 0;
+};
+
+// Materialized stream contents for multi-pass use. Elements live in fixed size chunks that are
+// never reallocated; past the spill threshold they are written to an anonymous file instead and
+// memory mapped once complete. Replays are cheap random access views and may run concurrently.
+template <typename T>
+class Cache
+{
+    static constexpr int shift = std::countr_zero(std::bit_floor(std::max<std::size_t>(1, (std::size_t{1} << 16) / sizeof(T))));
+    static constexpr std::size_t chunkSize = std::size_t{1} << shift;
+
+  public:
+    template <BasicStream S>
+    Cache(S &s, std::size_t spillBytes = -1)
+    {
+        while (!s.empty())
+            push(*s.next(), spillBytes);
+        finish();
+    }
+
+    Cache(Cache &&other) noexcept { *this = std::move(other); }
+
+    Cache &operator=(Cache &&other) noexcept
+    {
+        std::swap(_storage, other._storage);
+        std::swap(_chunks, other._chunks);
+        std::swap(_size, other._size);
+        std::swap(_file, other._file);
+        std::swap(_mapping, other._mapping);
+        std::swap(_mappingBytes, other._mappingBytes);
+        return *this;
+    }
+
+    ~Cache()
+    {
+#if JSTREAM_HAS_MMAP
+        if (_mapping)
+            ::munmap(_mapping, _mappingBytes);
+#endif
+        if (_file)
+            std::fclose(_file);
+    }
+
+    std::size_t size() const { return _size; }
+
+    bool spilled() const { return _file != nullptr; }
+
+    CacheStream<T> stream() const { return {_chunks.data(), _size, shift}; }
+
+  private:
+    void push(T const &t, std::size_t spillBytes)
+    {
+        if (_storage.empty() || _storage.back().size() == chunkSize)
+        {
+            if (_file || (std::is_trivially_copyable_v<T> && _size * sizeof(T) >= spillBytes && spill()))
+                flush();
+            _storage.emplace_back().reserve(chunkSize);
+        }
+        _storage.back().push_back(t);
+        _size++;
+    }
+
+    bool spill()
+    {
+#if JSTREAM_HAS_MMAP
+        if (!(_file = std::tmpfile()))
+            throw std::system_error(errno, std::generic_category(), "jstream: cannot create cache file");
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void flush()
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            for (std::vector<T> const &chunk : _storage)
+                if (std::fwrite(chunk.data(), sizeof(T), chunk.size(), _file) != chunk.size())
+                    throw std::system_error(errno, std::generic_category(), "jstream: cannot write cache file");
+            _storage.clear();
+        }
+    }
+
+    void finish()
+    {
+#if JSTREAM_HAS_MMAP
+        if (_file)
+        {
+            flush();
+            if (std::fflush(_file) != 0)
+                throw std::system_error(errno, std::generic_category(), "jstream: cannot write cache file");
+            _mappingBytes = _size * sizeof(T);
+            _mapping = ::mmap(nullptr, _mappingBytes, PROT_READ, MAP_PRIVATE, ::fileno(_file), 0);
+            if (_mapping == MAP_FAILED)
+            {
+                _mapping = nullptr;
+                throw std::system_error(errno, std::generic_category(), "jstream: cannot map cache file");
+            }
+            for (std::size_t i = 0; i < _size; i += chunkSize)
+                _chunks.push_back(static_cast<T const *>(_mapping) + i);
+            return;
+        }
+#endif
+        for (std::vector<T> const &chunk : _storage)
+            _chunks.push_back(chunk.data());
+    }
+
+    std::vector<std::vector<T>> _storage;
+    std::vector<T const *> _chunks;
+    std::size_t _size = 0;
+    std::FILE *_file = nullptr;
+    void *_mapping = nullptr;
+    std::size_t _mappingBytes = 0;
+};
+
+namespace detail
+{
+// Bounded single producer, single consumer ring. Each side works against a private cursor and a
+// cached copy of the other side's published one, and publishes its own only once per batch (or
+// before it waits), so the shared cache lines change hands once per batch rather than per element.
+// The producer also publishes at once while the consumer has drained everything published, so a
+// slow producer's elements are not held back for a whole batch.
+template <typename T>
+class SpscQueue
+{
+  public:
+    SpscQueue(std::size_t capacity, std::size_t batch)
+        : _slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))), _batch(std::clamp<std::size_t>(batch, 1, _slots.size() / 2)) {}
+
+    // Producer side; false once the consumer has cancelled.
+    bool push(T value)
+    {
+        for (Backoff backoff; _producer.position - _producer.cached == _slots.size(); backoff())
+        {
+            publish();
+            if (_cancelled.load(std::memory_order_relaxed))
+                return false;
+            _producer.cached = _head.load(std::memory_order_acquire);
+        }
+        _slots[_producer.position++ & (_slots.size() - 1)].emplace(std::move(value));
+        if (_producer.position % _batch == 0 || _head.load(std::memory_order_relaxed) == _producer.published)
+            publish();
+        return true;
+    }
+
+    void close()
+    {
+        publish();
+        _closed.store(true, std::memory_order_release);
+    }
+
+    // Consumer side; empty once the producer has closed and everything was consumed.
+    std::optional<T> pop()
+    {
+        for (Backoff backoff; _consumer.position == _consumer.cached; backoff())
+        {
+            _head.store(_consumer.position, std::memory_order_release);
+            bool closed = _closed.load(std::memory_order_acquire);
+            _consumer.cached = _tail.load(std::memory_order_acquire);
+            if (closed && _consumer.position == _consumer.cached)
+                return std::nullopt;
+        }
+        auto &slot = _slots[_consumer.position++ & (_slots.size() - 1)];
+        std::optional<T> value = std::move(slot);
+        slot.reset();
+        if (_consumer.position % _batch == 0)
+            _head.store(_consumer.position, std::memory_order_release);
+        return value;
+    }
+
+    void cancel() { _cancelled.store(true, std::memory_order_relaxed); }
+
+    bool cancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+
+  private:
+    void publish()
+    {
+        _producer.published = _producer.position;
+        _tail.store(_producer.position, std::memory_order_release);
+    }
+
+    struct alignas(cacheLine) Cursor
+    {
+        std::size_t position = 0;
+        std::size_t cached = 0;
+        std::size_t published = 0;
+    };
+
+    std::vector<std::optional<T>> _slots;
+    std::size_t _batch;
+    alignas(cacheLine) std::atomic<std::size_t> _head{0};
+    alignas(cacheLine) std::atomic<std::size_t> _tail{0};
+    alignas(cacheLine) std::atomic<bool> _closed{false};
+    std::atomic<bool> _cancelled{false};
+    Cursor _producer;
+    Cursor _consumer;
+};
+} // namespace detail
+
+// Runs everything upstream on a dedicated thread, started on first use. The producer checks for
+// cancellation before every element: limit(), takeWhile() and short-circuiting terminals cancel
+// it as soon as they stop pulling, and destroying the stage cancels and joins it. Exceptions
+// thrown upstream are rethrown to the consumer.
+template <typename S>
+class AsyncStream : public Stream<AsyncStream<S>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type *;
+    static constexpr bool sorted = SortedStream<S>;
+
+    AsyncStream(S &s, std::size_t queueDepth, std::size_t batchSize) : _stream(s), _queue(queueDepth, batchSize) {}
+
+    AsyncStream(AsyncStream const &) = delete;
+    AsyncStream &operator=(AsyncStream const &) = delete;
+
+    ~AsyncStream()
+    {
+        _queue.cancel();
+        if (_producer.joinable())
+            _producer.join();
+    }
+
+    next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _ready = false;
+        return &*_currentElement;
+    }
+
+    bool empty()
+    {
+        if (_ready)
+            return false;
+        if (!_producer.joinable())
+            _producer = std::thread([this] { produce(); });
+        _currentElement = _queue.pop();
+        if (!_currentElement && _error)
+            std::rethrow_exception(std::exchange(_error, nullptr));
+        return !(_ready = _currentElement.has_value());
+    }
+
+    void cancel() { _queue.cancel(); }
+
+  private:
+    void produce()
+    {
+        try
+        {
+            while (!_queue.cancelled() && !_stream.empty())
+                if (!_queue.push(*_stream.next()))
+                    break;
+        }
+        catch (...)
+        {
+            _error = std::current_exception();
+        }
+        _queue.close();
+    }
+
+    S &_stream;
+    detail::SpscQueue<value_type> _queue;
+    std::thread _producer;
+    std::exception_ptr _error;
+    bool _ready = false;
+    std::optional<value_type> _currentElement;
+};
+
+// Applies f on an Executor, at most `threads` elements at a time. The calling thread keeps pulling
+// upstream, so any source works, and at most `window` elements are in flight; ordered output waits
+// for the oldest one, which bounds the reorder buffer to the same window. f must be safe to call
+// concurrently.
+template <typename S, typename F, bool Ordered>
+class ParallelMapStream : public Stream<ParallelMapStream<S, F, Ordered>>
+{
+    using input_type = typename S::value_type;
+
+  public:
+    using value_type = std::remove_cvref_t<std::invoke_result_t<F &, input_type const &>>;
+    using next_type = value_type *;
+
+    ParallelMapStream(S &s, F f, std::size_t threads, std::size_t window, Executor &executor)
+        : _stream(s), _f(f), _executor(executor), _threads(threads ? threads : executor.concurrency()),
+          _slots(window ? window : 4 * _threads) {}
+
+    ParallelMapStream(ParallelMapStream const &) = delete;
+    ParallelMapStream &operator=(ParallelMapStream const &) = delete;
+
+    ~ParallelMapStream()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _executor.waitUntil([this] {
+            std::lock_guard lock(_mutex);
+            return _active == 0;
+        });
+    }
+
+    // Emits results as soon as they complete instead of in encounter order.
+    auto unordered() requires Ordered { return ParallelMapStream<S, F, false>{_stream, _f, _threads, _slots.size(), _executor}; }
+
+    next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _ready = false;
+        return &*_currentElement;
+    }
+
+    bool empty()
+    {
+        if (_ready)
+            return false;
+        if (!_started)
+        {
+            for (std::size_t slot = 0; slot < _slots.size(); slot++)
+                _free.push_back(slot);
+            _started = true;
+        }
+        submit();
+        std::deque<std::size_t> &results = Ordered ? _order : _completed;
+        {
+            std::lock_guard lock(_mutex);
+            if (_free.size() == _slots.size())
+                return true;
+        }
+        _executor.waitUntil([&] {
+            std::lock_guard lock(_mutex);
+            return !results.empty() && _slots[results.front()].done;
+        });
+        // The slot is reset before it is freed, so a caller that catches a rethrown error and
+        // keeps pulling never sees it reused half-done.
+        std::unique_lock lock(_mutex);
+        Slot &slot = _slots[results.front()];
+        results.pop_front();
+        std::exception_ptr error = std::exchange(slot.error, nullptr);
+        if (!error)
+            _currentElement = std::move(slot.output);
+        slot.output.reset();
+        slot.done = false;
+        _free.push_back(&slot - _slots.data());
+        lock.unlock();
+        if (error)
+            std::rethrow_exception(error);
+        return !(_ready = true);
+    }
+
+  private:
+    struct Slot
+    {
+        std::optional<input_type> input;
+        std::optional<value_type> output;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    // Tops the window up from upstream; only the calling thread touches the upstream stream.
+    void submit()
+    {
+        while (true)
+        {
+            std::unique_lock lock(_mutex);
+            if (_free.empty())
+                return;
+            std::size_t slot = _free.front();
+            lock.unlock();
+            if (_stream.empty())
+                return;
+            _slots[slot].input.emplace(*_stream.next());
+            lock.lock();
+            _free.pop_front();
+            _tasks.push_back(slot);
+            if constexpr (Ordered)
+                _order.push_back(slot);
+            bool spawn = _active < _threads;
+            _active += spawn;
+            lock.unlock();
+            if (spawn)
+                _executor.submit([this] { drain(); });
+        }
+    }
+
+    // Pool task: maps queued elements until none are left.
+    void drain()
+    {
+        std::unique_lock lock(_mutex);
+        while (!_stopping && !_tasks.empty())
+        {
+            Slot &slot = _slots[_tasks.front()];
+            _tasks.pop_front();
+            lock.unlock();
+            try
+            {
+                slot.output.emplace(_f(*slot.input));
+            }
+            catch (...)
+            {
+                slot.error = std::current_exception();
+            }
+            slot.input.reset();
+            lock.lock();
+            slot.done = true;
+            if constexpr (!Ordered)
+                _completed.push_back(&slot - _slots.data());
+            lock.unlock();
+            _executor.notify();
+            lock.lock();
+        }
+        _active--;
+    }
+
+    S &_stream;
+    F _f;
+    Executor &_executor;
+    std::size_t _threads;
+    std::vector<Slot> _slots;
+    std::mutex _mutex;
+    std::deque<std::size_t> _free;
+    std::deque<std::size_t> _tasks;
+    std::deque<std::size_t> _order;
+    std::deque<std::size_t> _completed;
+    std::size_t _active = 0;
+    bool _stopping = false;
+    bool _started = false;
+    bool _ready = false;
+    std::optional<value_type> _currentElement;
+};
+
+// Marks a random access stream for parallel evaluation on an Executor: short-circuiting
+// terminals split it by index range across the pool and stop every range once the answer is
+// known. Sequential use is unchanged. at() must be safe to call concurrently.
+template <typename S>
+class ParallelSourceStream : public Stream<ParallelSourceStream<S>>
+{
+  public:
+    using next_type = typename S::next_type;
+    using value_type = typename S::value_type;
+    static constexpr bool sorted = SortedStream<S>;
+
+    ParallelSourceStream(S &s, Executor &executor) : _stream(s), _executor(executor) {}
+
+    next_type next() { return _stream.next(); }
+    bool empty() { return _stream.empty(); }
+
+    std::size_t size() { return _stream.size(); }
+    decltype(auto) at(std::size_t i) { return _stream.at(i); }
+    void skip(std::size_t n) { _stream.skip(n); }
+    next_type data() requires ContiguousStream<S> { return _stream.data(); }
+
+    Executor &executor() { return _executor; }
+
+  private:
+    S &_stream;
+    Executor &_executor;
+};
+
+template <typename S, typename T, typename Op, bool Inclusive>
+class ScanStream : public Stream<ScanStream<S, T, Op, Inclusive>>
+{
+    using input_type = typename S::value_type;
+    static constexpr bool combinable = std::is_invocable_r_v<T, Op &, T const &, T const &>;
+    static constexpr bool blocked = ContiguousStream<S> && std::is_arithmetic_v<input_type> && std::is_arithmetic_v<T> && combinable;
+    static constexpr bool parallel = ParallelStream<S> && std::is_default_constructible_v<T> && combinable;
+
+  public:
+    using value_type = T;
+    using next_type = value_type *;
+
+    constexpr ScanStream(S &s, Op op, T init) : _stream(s), _op(op), _carry(init) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        return &_buffer[_position++];
+    }
+
+    constexpr bool empty()
+    {
+        if (_position < _buffer.size())
+            return false;
+        _buffer.clear();
+        _position = 0;
+        if constexpr (parallel)
+            scanParallel();
+        else if constexpr (blocked)
+            scanBlock();
+        else if (!_stream.empty())
+        {
+            T before = _carry;
+            _carry = _op(_carry, *_stream.next());
+            _buffer.push_back(Inclusive ? _carry : std::move(before));
+        }
+        return _buffer.empty();
+    }
+
+  private:
+    // Turns the inclusive results in _buffer into exclusive ones.
+    constexpr void shift(T before)
+    {
+        if constexpr (!Inclusive)
+        {
+            std::move_backward(_buffer.begin(), _buffer.end() - 1, _buffer.end());
+            _buffer.front() = std::move(before);
+        }
+    }
+
+    constexpr void scanBlock()
+    {
+        constexpr std::size_t block = 256;
+        std::size_t n = std::min(_stream.size(), block);
+        if (!n)
+            return;
+        _buffer.resize(n);
+        T before = _carry;
+        _carry = detail::prefixScan(_stream.data(), _buffer.data(), n, _op, _carry);
+        _stream.skip(n);
+        shift(before);
+    }
+
+    // Scans every range independently, folds the range totals into per-range carries, then
+    // combines each range with its carry.
+    void scanParallel()
+    {
+        std::size_t n = _stream.size();
+        if (!n)
+            return;
+        _buffer.resize(n);
+        Executor &executor = _stream.executor();
+        std::size_t ranges = detail::rangeCount(executor, n);
+        std::vector<T> carries(ranges);
+        executor.parallelFor(ranges, [&](std::size_t r) {
+            std::size_t lo = n * r / ranges, hi = n * (r + 1) / ranges;
+            T carry = static_cast<T>(_stream.at(lo));
+            _buffer[lo] = carry;
+            if constexpr (blocked)
+                detail::prefixScan(_stream.data() + lo + 1, _buffer.data() + lo + 1, hi - lo - 1, _op, carry);
+            else
+                for (std::size_t i = lo + 1; i < hi; i++)
+                    _buffer[i] = carry = _op(carry, _stream.at(i));
+        });
+        T before = _carry;
+        for (std::size_t r = 0; r < ranges; r++)
+        {
+            carries[r] = _carry;
+            _carry = _op(_carry, _buffer[n * (r + 1) / ranges - 1]);
+        }
+        executor.parallelFor(ranges, [&](std::size_t r) {
+            for (std::size_t i = n * r / ranges, hi = n * (r + 1) / ranges; i < hi; i++)
+                _buffer[i] = _op(carries[r], _buffer[i]);
+        });
+        _stream.skip(n);
+        shift(before);
+    }
+
+    S &_stream;
+    Op _op;
+    T _carry;
+    std::vector<T> _buffer;
+    std::size_t _position = 0;
+};
+
+// Drains the upstream into a buffer on first use, sorts it with Sorter and then serves it with
+// random access.
+template <typename S, typename Sorter, bool Ascending>
+class SortStream : public Stream<SortStream<S, Sorter, Ascending>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type *;
+    static constexpr bool sorted = Ascending;
+
+    SortStream(S &s, Sorter sorter) : _stream(s), _sorter(sorter) {}
+
+    bool empty() { return size() == 0; }
+
+    next_type next()
+    {
+        if (empty())
+            return nullptr;
+        return &_elements[_position++];
+    }
+
+    std::size_t size()
+    {
+        fill();
+        return _elements.size() - _position;
+    }
+
+    value_type &at(std::size_t i)
+    {
+        fill();
+        return _elements[_position + i];
+    }
+
+    void skip(std::size_t n)
+    {
+        fill();
+        _position += n;
+    }
+
+    next_type data()
+    {
+        fill();
+        return _elements.data() + _position;
+    }
+
+  private:
+    void fill()
+    {
+        if (_filled)
+            return;
+        _filled = true;
+        if constexpr (RandomAccessStream<S>)
+            _elements.reserve(_stream.size());
+        while (!_stream.empty())
+            _elements.push_back(*_stream.next());
+        Executor *executor = nullptr;
+        if constexpr (ParallelStream<S>)
+            executor = &_stream.executor();
+        _sorter(_elements, executor);
+    }
+
+    S &_stream;
+    Sorter _sorter;
+    bool _filled = false;
+    std::vector<value_type> _elements;
+    std::size_t _position = 0;
+};
+
+template <typename S>
+class WindowStream : public Stream<WindowStream<S>>
+{
+  public:
+    using value_type = std::span<typename S::value_type const>;
+    using next_type = value_type *;
+
+    constexpr WindowStream(S &s, std::size_t size, std::size_t step, bool partial)
+        : _stream(s), _size(size), _step(step), _partial(partial)
+    {
+        if (size == 0 || step == 0)
+            throw std::invalid_argument("jstream: window size and step must be positive");
+        if constexpr (!ContiguousStream<S>)
+            _buffer.resize(_step < _size ? 2 * _size : _size);
+    }
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        if constexpr (ContiguousStream<S>)
+        {
+            _currentElement = at(0);
+            skip(1);
+        }
+        _ready = false;
+        return &_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        if constexpr (ContiguousStream<S>)
+            return size() == 0;
+        else
+            return !_ready && !(_ready = fill());
+    }
+
+    constexpr std::size_t size() requires ContiguousStream<S>
+    {
+        std::size_t remaining = _stream.size();
+        if (_partial)
+            return (remaining + _step - 1) / _step;
+        return remaining < _size ? 0 : (remaining - _size) / _step + 1;
+    }
+
+    constexpr value_type at(std::size_t i) requires ContiguousStream<S>
+    {
+        std::size_t offset = i * _step;
+        return value_type{_stream.data() + offset, std::min(_size, _stream.size() - offset)};
+    }
+
+    constexpr void skip(std::size_t n) requires ContiguousStream<S>
+    {
+        _stream.skip(std::min(n * _step, _stream.size()));
+    }
+
+  private:
+    constexpr bool fill()
+    {
+        if (_step < _size)
+        {
+            // Overlapping windows live in a mirrored ring buffer: every element is written at
+            // k % size and k % size + size, so the latest `size` elements are always contiguous.
+            std::size_t wanted = _pushed == 0 ? _size : _step;
+            for (; wanted > 0 && !_stream.empty(); wanted--, _pushed++)
+                _buffer[_pushed % _size] = _buffer[_pushed % _size + _size] = *_stream.next();
+            if (wanted > 0)
+                return false;
+            _currentElement = value_type{_buffer.data() + _pushed % _size, _size};
+            return true;
+        }
+        if (_pushed > 0)
+            for (std::size_t gap = _step - _size; gap > 0 && !_stream.empty(); gap--)
+                _stream.next();
+        std::size_t filled = 0;
+        for (; filled < _size && !_stream.empty(); filled++)
+            _buffer[filled] = *_stream.next();
+        _pushed += filled;
+        _currentElement = value_type{_buffer.data(), filled};
+        return filled == _size || (_partial && filled > 0);
+    }
+
+    S &_stream;
+    std::size_t _size;
+    std::size_t _step;
+    bool _partial;
+    bool _ready = false;
+    std::size_t _pushed = 0;
+    std::vector<typename S::value_type> _buffer;
+    value_type _currentElement;
+};
+
+template <typename S>
+class SlidingSumStream : public Stream<SlidingSumStream<S>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type *;
+
+    constexpr SlidingSumStream(S &s, std::size_t size) : _stream(s), _size(size), _buffer(size)
+    {
+        if (size == 0)
+            throw std::invalid_argument("jstream: sliding window size must be positive");
+    }
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        value_type &slot = _buffer[_pushed++ % _size];
+        _currentElement -= slot;
+        slot = *_stream.next();
+        _currentElement += slot;
+        return &_currentElement;
+    }
+
+    constexpr bool empty()
+    {
+        for (; _pushed + 1 < _size && !_stream.empty(); _pushed++)
+        {
+            _buffer[_pushed] = *_stream.next();
+            _currentElement += _buffer[_pushed];
+        }
+        return _pushed + 1 < _size || _stream.empty();
+    }
+
+  private:
+    S &_stream;
+    std::size_t _size;
+    std::size_t _pushed = 0;
+    std::vector<value_type> _buffer;
+    value_type _currentElement{};
+};
+
+template <typename S, typename Cmp>
+class SlidingExtremumStream : public Stream<SlidingExtremumStream<S, Cmp>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type *;
+
+    constexpr SlidingExtremumStream(S &s, std::size_t size, Cmp cmp) : _stream(s), _size(size), _cmp(cmp), _deque(size)
+    {
+        if (size == 0)
+            throw std::invalid_argument("jstream: sliding window size must be positive");
+    }
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        push();
+        return &_deque[_head].second;
+    }
+
+    constexpr bool empty()
+    {
+        while (_pushed + 1 < _size && !_stream.empty())
+            push();
+        return _pushed + 1 < _size || _stream.empty();
+    }
+
+  private:
+    // Monotonic deque over a fixed ring: the front is the extremum of the current window and
+    // every element is pushed and popped at most once.
+    constexpr void push()
+    {
+        value_type v = *_stream.next();
+        while (_count > 0 && !_cmp(_deque[(_head + _count - 1) % _size].second, v))
+            _count--;
+        if (_count > 0 && _deque[_head].first + _size <= _pushed)
+        {
+            _head = (_head + 1) % _size;
+            _count--;
+        }
+        _deque[(_head + _count++) % _size] = {_pushed++, std::move(v)};
+    }
+
+    S &_stream;
+    std::size_t _size;
+    Cmp _cmp;
+    std::size_t _pushed = 0;
+    std::size_t _head = 0;
+    std::size_t _count = 0;
+    std::vector<std::pair<std::size_t, value_type>> _deque;
+};
+
+template <typename Cmp, typename... S>
+class MergeSortedStream : public Stream<MergeSortedStream<Cmp, S...>>
+{
+  public:
+    using value_type = std::common_type_t<typename S::value_type...>;
+    using next_type = value_type const *;
+    static constexpr bool sorted = std::is_same_v<Cmp, std::less<>>;
+
+    static_assert((std::is_same_v<typename S::value_type, value_type> && ...), "merged streams must share a value_type");
+
+    constexpr MergeSortedStream(Cmp cmp, S &...s) : _streams(s...), _tree(cmp) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _pending = true;
+        return _tree.top();
+    }
+
+    constexpr bool empty()
+    {
+        if (!_started)
+        {
+            _started = true;
+            _tree.build(std::apply([](auto &...s) { return std::vector<next_type>{pull(s)...}; }, _streams));
+        }
+        else if (_pending)
+        {
+            _pending = false;
+            _tree.replaceTop(pull(_tree.winner(), std::index_sequence_for<S...>{}));
+        }
+        return !_tree.top();
+    }
+
+  private:
+    static constexpr next_type pull(auto &s) { return s.empty() ? nullptr : s.next(); }
+
+    template <std::size_t... I>
+    constexpr next_type pull(std::size_t i, std::index_sequence<I...>)
+    {
+        next_type head = nullptr;
+        ((i == I ? (head = pull(std::get<I>(_streams)), 0) : 0), ...);
+        return head;
+    }
+
+    std::tuple<S &...> _streams;
+    detail::LoserTree<next_type, Cmp> _tree;
+    bool _started = false;
+    bool _pending = false;
+};
+
+template <typename S, typename Cmp>
+class DynamicMergeSortedStream : public Stream<DynamicMergeSortedStream<S, Cmp>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type const *;
+    static constexpr bool sorted = std::is_same_v<Cmp, std::less<>>;
+
+    constexpr DynamicMergeSortedStream(std::vector<S> &streams, Cmp cmp) : _streams(streams), _tree(cmp) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _pending = true;
+        return _tree.top();
+    }
+
+    constexpr bool empty()
+    {
+        if (!_started)
+        {
+            _started = true;
+            std::vector<next_type> heads;
+            heads.reserve(_streams.size());
+            for (S &s : _streams)
+                heads.push_back(pull(s));
+            _tree.build(std::move(heads));
+        }
+        else if (_pending)
+        {
+            _pending = false;
+            _tree.replaceTop(pull(_streams[_tree.winner()]));
+        }
+        return !_tree.top();
+    }
+
+  private:
+    static constexpr next_type pull(S &s) { return s.empty() ? nullptr : s.next(); }
+
+    std::vector<S> &_streams;
+    detail::LoserTree<next_type, Cmp> _tree;
+    bool _started = false;
+    bool _pending = false;
+};
+
+// Set operations over sorted streams follow std::set_intersection, std::set_union and
+// std::set_difference. The lagging side catches up with skipTo(), so a short input against a
+// long seekable one costs about |short| * log|long| comparisons.
+template <typename A, typename B, typename Cmp>
+class IntersectSortedStream : public Stream<IntersectSortedStream<A, B, Cmp>>
+{
+  public:
+    using next_type = typename A::next_type;
+    using value_type = typename A::value_type;
+    static constexpr bool sorted = std::is_same_v<Cmp, std::less<>>;
+
+    constexpr IntersectSortedStream(A &a, B &b, Cmp cmp) : _a(a), _b(b), _cmp(cmp) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _a.advance();
+        _b.advance();
+        return _a.head();
+    }
+
+    constexpr bool empty()
+    {
+        while (true)
+        {
+            auto x = _a.peek();
+            auto y = x ? _b.peek() : nullptr;
+            if (!x || !y)
+                return true;
+            if (_cmp(*x, *y))
+                _a.seek(*y, _cmp);
+            else if (_cmp(*y, *x))
+                _b.seek(*x, _cmp);
+            else
+                return false;
+        }
+    }
+
+    template <typename K>
+    constexpr void skipTo(K const &key, Cmp const & = {})
+    {
+        _a.seek(key, _cmp);
+        _b.seek(key, _cmp);
+    }
+
+  private:
+    detail::Cursor<A> _a;
+    detail::Cursor<B> _b;
+    Cmp _cmp;
+};
+
+template <typename A, typename B, typename Cmp>
+class UnionSortedStream : public Stream<UnionSortedStream<A, B, Cmp>>
+{
+  public:
+    using value_type = std::common_type_t<typename A::value_type, typename B::value_type>;
+    using next_type = value_type const *;
+    static constexpr bool sorted = std::is_same_v<Cmp, std::less<>>;
+
+    constexpr UnionSortedStream(A &a, B &b, Cmp cmp) : _a(a), _b(b), _cmp(cmp) {}
+
+    constexpr next_type next()
+    {
+        auto x = _a.peek();
+        auto y = _b.peek();
+        if (x && (!y || _cmp(*x, *y)))
+        {
+            _a.advance();
+            return x;
+        }
+        if (y && (!x || _cmp(*y, *x)))
+        {
+            _b.advance();
+            return y;
+        }
+        if (x)
+        {
+            _a.advance();
+            _b.advance();
+        }
+        return x;
+    }
+
+    constexpr bool empty() { return !_a.peek() && !_b.peek(); }
+
+    template <typename K>
+    constexpr void skipTo(K const &key, Cmp const & = {})
+    {
+        _a.seek(key, _cmp);
+        _b.seek(key, _cmp);
+    }
+
+  private:
+    detail::Cursor<A> _a;
+    detail::Cursor<B> _b;
+    Cmp _cmp;
+};
+
+template <typename A, typename B, typename Cmp>
+class DifferenceSortedStream : public Stream<DifferenceSortedStream<A, B, Cmp>>
+{
+  public:
+    using next_type = typename A::next_type;
+    using value_type = typename A::value_type;
+    static constexpr bool sorted = std::is_same_v<Cmp, std::less<>>;
+
+    constexpr DifferenceSortedStream(A &a, B &b, Cmp cmp) : _a(a), _b(b), _cmp(cmp) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _a.advance();
+        return _a.head();
+    }
+
+    constexpr bool empty()
+    {
+        while (true)
+        {
+            auto x = _a.peek();
+            if (!x)
+                return true;
+            auto y = _b.peek();
+            if (!y || _cmp(*x, *y))
+                return false;
+            if (_cmp(*y, *x))
+                _b.seek(*x, _cmp);
+            else
+            {
+                _a.advance();
+                _b.advance();
+            }
+        }
+    }
+
+    template <typename K>
+    constexpr void skipTo(K const &key, Cmp const & = {})
+    {
+        _a.seek(key, _cmp);
+    }
+
+  private:
+    detail::Cursor<A> _a;
+    detail::Cursor<B> _b;
+    Cmp _cmp;
+};
+
+namespace detail
+{
+// Open addressing multimap from keys to row indices. Slots hold the first row of each distinct
+// key and rows sharing a key are chained in build order; all indices are stored off by one so
+// that zero means empty.
+template <typename K>
+class JoinTable
+{
+  public:
+    constexpr void build(std::vector<K> const &keys)
+    {
+        _keys = &keys;
+        _mask = std::bit_ceil(2 * keys.size() + 1) - 1;
+        _slots.assign(_mask + 1, 0);
+        _chain.assign(keys.size(), 0);
+        for (std::size_t row = keys.size(); row-- > 0;)
+        {
+            std::uint32_t &slot = _slots[find(keys[row], hash(keys[row]))];
+            _chain[row] = slot;
+            slot = static_cast<std::uint32_t>(row + 1);
+        }
+    }
+
+    constexpr std::uint32_t first(K const &key, std::uint64_t h) const { return _slots[find(key, h)]; }
+
+    constexpr std::uint32_t chain(std::uint32_t row) const { return _chain[row - 1]; }
+
+  private:
+    constexpr std::size_t find(K const &key, std::uint64_t h) const
+    {
+        std::size_t slot = h & _mask;
+        while (_slots[slot] && !((*_keys)[_slots[slot] - 1] == key))
+            slot = (slot + 1) & _mask;
+        return slot;
+    }
+
+    std::vector<K> const *_keys = nullptr;
+    std::size_t _mask = 0;
+    std::vector<std::uint32_t> _slots;
+    std::vector<std::uint32_t> _chain;
+};
+
+// Builds a JoinTable over the materialized build side and probes it with the other stream.
+// When the build side would not fit in cache it is radix partitioned on the top hash bits, with
+// one table per partition. The probe side is then read in batches of about cacheBytes, each
+// partitioned the same way and joined one partition at a time, so the table in use stays cache
+// resident while the probe side is still streamed.
+template <JoinKind Kind, bool BuildLeft, typename Probe, typename Build, typename PK, typename BK>
+class HashJoin
+{
+    using probe_type = typename Probe::value_type;
+    using build_type = typename Build::value_type;
+    using left_type = std::conditional_t<BuildLeft, build_type, probe_type>;
+    using right_type = std::conditional_t<BuildLeft, probe_type, build_type>;
+    using key_type = std::remove_cvref_t<std::invoke_result_t<PK &, probe_type const &>>;
+
+  public:
+    using value_type = std::conditional_t<Kind == JoinKind::inner, std::pair<left_type const &, right_type const &>,
+                       std::conditional_t<Kind == JoinKind::left, std::pair<left_type const &, right_type const *>,
+                       left_type>>;
+    using next_type = value_type const *;
+
+    constexpr HashJoin(Probe &probe, Build &build, PK pk, BK bk) : _probe(probe), _build(build), _pk(pk), _bk(bk) {}
+
+    constexpr next_type pull()
+    {
+        if (!_started)
+            start();
+        while (true)
+        {
+            if (_match)
+            {
+                std::uint32_t row = _match;
+                _match = _tables[_partition].chain(row);
+                return emit(*_probeRow, &_buildRows[_partition][row - 1]);
+            }
+            if (!(_probeRow = nextProbe()))
+                return nullptr;
+            key_type key = _pk(*_probeRow);
+            std::uint32_t first = _tables[_partition].first(key, hash(key));
+            if constexpr (Kind == JoinKind::semi || Kind == JoinKind::anti)
+            {
+                if ((first != 0) == (Kind == JoinKind::semi))
+                    return _probeRow;
+            }
+            else if (Kind == JoinKind::left && !first)
+                return emit(*_probeRow, nullptr);
+            else
+                _match = first;
+        }
+    }
+
+  private:
+    constexpr void start()
+    {
+        _started = true;
+        std::vector<build_type> rows;
+        if constexpr (RandomAccessStream<Build>)
+            rows.reserve(_build.size());
+        while (!_build.empty())
+            rows.push_back(*_build.next());
+        std::size_t bytes = rows.size() * (sizeof(build_type) + sizeof(key_type) + 2 * sizeof(std::uint32_t));
+        if (bytes > cacheBytes)
+            _bits = std::bit_width((bytes - 1) / cacheBytes);
+        std::size_t partitions = std::size_t{1} << _bits;
+        _buildRows.resize(partitions);
+        if (partitions == 1)
+            _buildRows[0] = std::move(rows);
+        else
+        {
+            _batch.resize(partitions);
+            _partition = partitions - 1;
+            for (build_type &row : rows)
+                _buildRows[partition(_bk(row))].push_back(std::move(row));
+        }
+        // Tables point into _keys, which is sized once so its vectors never move.
+        _keys.resize(partitions);
+        _tables.resize(partitions);
+        for (std::size_t p = 0; p < partitions; p++)
+        {
+            for (build_type const &row : _buildRows[p])
+                _keys[p].push_back(_bk(row));
+            _tables[p].build(_keys[p]);
+        }
+    }
+
+    constexpr std::size_t partition(key_type const &key) const { return hash(key) >> (64 - _bits); }
+
+    constexpr probe_type const *nextProbe()
+    {
+        if (_batch.empty())
+            return _probe.empty() ? nullptr : &*_probe.next();
+        while (_position == _batch[_partition].size())
+        {
+            if (_partition + 1 < _batch.size())
+            {
+                _partition++;
+                _position = 0;
+                continue;
+            }
+            for (auto &rows : _batch)
+                rows.clear();
+            std::size_t limit = std::max<std::size_t>(1, cacheBytes / sizeof(probe_type));
+            for (std::size_t n = 0; n < limit && !_probe.empty(); n++)
+            {
+                probe_type const &row = *_probe.next();
+                _batch[partition(_pk(row))].push_back(row);
+            }
+            if (std::all_of(_batch.begin(), _batch.end(), [](auto const &rows) { return rows.empty(); }))
+                return nullptr;
+            _partition = 0;
+            _position = 0;
+        }
+        return &_batch[_partition][_position++];
+    }
+
+    constexpr next_type emit(probe_type const &probe, build_type const *build)
+    {
+        if constexpr (Kind == JoinKind::inner)
+        {
+            if constexpr (BuildLeft)
+                _current.emplace(*build, probe);
+            else
+                _current.emplace(probe, *build);
+            return &*_current;
+        }
+        else if constexpr (Kind == JoinKind::left)
+        {
+            _current.emplace(probe, build);
+            return &*_current;
+        }
+        return nullptr;
+    }
+
+    Probe &_probe;
+    Build &_build;
+    PK _pk;
+    BK _bk;
+    bool _started = false;
+    int _bits = 0;
+    std::vector<std::vector<build_type>> _buildRows;
+    std::vector<std::vector<key_type>> _keys;
+    std::vector<JoinTable<key_type>> _tables;
+    std::vector<std::vector<probe_type>> _batch;
+    std::size_t _partition = 0;
+    std::size_t _position = 0;
+    probe_type const *_probeRow = nullptr;
+    std::uint32_t _match = 0;
+    std::optional<value_type> _current;
+};
+} // namespace detail
+
+// Inner joins build the hash table on the smaller input when both sizes are known, otherwise on
+// the right one; the other joins always build on the right and stream the left.
+template <typename L, typename R, typename LK, typename RK, JoinKind Kind>
+class HashJoinStream : public Stream<HashJoinStream<L, R, LK, RK, Kind>>
+{
+    using right_build = detail::HashJoin<Kind, false, L, R, LK, RK>;
+    using left_build = std::conditional_t<Kind == JoinKind::inner && RandomAccessStream<L> && RandomAccessStream<R>,
+                                          detail::HashJoin<Kind, true, R, L, RK, LK>, right_build>;
+
+  public:
+    using value_type = typename right_build::value_type;
+    using next_type = value_type const *;
+
+    constexpr HashJoinStream(L &l, R &r, LK lk, RK rk) : _left(l), _right(r), _lk(lk), _rk(rk) {}
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        next_type ret = nullptr;
+        std::swap(ret, _next);
+        return ret;
+    }
+
+    constexpr bool empty()
+    {
+        if (!_next && !_done)
+        {
+            if (!_rightBuild && !_leftBuild)
+            {
+                if constexpr (!std::is_same_v<left_build, right_build>)
+                    if (_left.size() < _right.size())
+                        _leftBuild.emplace(_right, _left, _rk, _lk);
+                if (!_leftBuild)
+                    _rightBuild.emplace(_left, _right, _lk, _rk);
+            }
+            _next = _leftBuild ? _leftBuild->pull() : _rightBuild->pull();
+            _done = !_next;
+        }
+        return !_next;
+    }
+
+  private:
+    L &_left;
+    R &_right;
+    LK _lk;
+    RK _rk;
+    std::optional<right_build> _rightBuild;
+    std::optional<left_build> _leftBuild;
+    next_type _next = nullptr;
+    bool _done = false;
+};
+
+// Row of a columns() table: a pointer to the columns and a row index, so a consumer touches only
+// the columns it reads. Fields are read with get<I>() or structured bindings.
+template <typename... T>
+class ColumnRow
+{
+  public:
+    using columns_type = std::tuple<std::span<T const>...>;
+
+    constexpr ColumnRow() = default;
+    constexpr ColumnRow(columns_type const *columns, std::size_t index) : _columns(columns), _index(index) {}
+
+    template <std::size_t I>
+    constexpr auto const &get() const { return std::get<I>(*_columns)[_index]; }
+
+    constexpr std::size_t index() const { return _index; }
+
+    constexpr std::tuple<T...> materialize() const
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) { return std::tuple<T...>{get<I>()...}; }(std::index_sequence_for<T...>{});
+    }
+
+  private:
+    columns_type const *_columns = nullptr;
+    std::size_t _index = 0;
+};
+
+namespace detail
+{
+// Block of rows flowing through where() stages: either all of [begin, end) or the rows listed,
+// as offsets from begin, in a selection vector.
+struct Selection
+{
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool dense = true;
+    std::vector<std::uint32_t> rows;
+
+    constexpr std::size_t size() const { return dense ? end - begin : rows.size(); }
+    constexpr std::size_t row(std::size_t k) const { return begin + (dense ? k : rows[k]); }
+};
+} // namespace detail
+
+// Structure-of-arrays source over contiguous columns, yielding ColumnRow proxies. where<I>(p)
+// filters on column I alone a block at a time, producing selection vectors, so other columns
+// are only read for surviving rows.
+template <typename... T>
+class ColumnStream : public Stream<ColumnStream<T...>>
+{
+  public:
+    using value_type = ColumnRow<T...>;
+    using next_type = value_type *;
+    using columns_type = typename value_type::columns_type;
+    static constexpr std::size_t block = 1024;
+
+    constexpr ColumnStream(std::span<T const>... columns) : _columns(columns...), _size(std::min({columns.size()...})) {}
+
+    constexpr bool empty() { return _position == _size; }
+
+    constexpr next_type next()
+    {
+        _current = {&_columns, _position++};
+        return &_current;
+    }
+
+    constexpr std::size_t size() { return _size - _position; }
+    constexpr value_type at(std::size_t i) { return {&_columns, _position + i}; }
+    constexpr void skip(std::size_t n) { _position += n; }
+
+    template <std::size_t I, typename P>
+    constexpr auto where(P &&p) { return ColumnFilterStream<ColumnStream, I, P>{*this, std::forward<P>(p)}; }
+
+    constexpr bool nextBlock(detail::Selection &selection)
+    {
+        if (_position == _size)
+            return false;
+        selection.begin = _position;
+        selection.end = _position = std::min(_position + block, _size);
+        selection.dense = true;
+        return true;
+    }
+
+    constexpr columns_type const &columns() const { return _columns; }
+
+  private:
+    columns_type _columns;
+    std::size_t _size;
+    std::size_t _position = 0;
+    value_type _current;
+};
+
+template <typename S, std::size_t I, typename P>
+class ColumnFilterStream : public Stream<ColumnFilterStream<S, I, P>>
+{
+  public:
+    using value_type = typename S::value_type;
+    using next_type = value_type *;
+
+    constexpr ColumnFilterStream(S &s, P p) : _stream(s), _p(p) {}
+
+    constexpr bool empty()
+    {
+        while (_position == _selection.size())
+        {
+            if (!nextBlock(_selection))
+                return true;
+            _position = 0;
+        }
+        return false;
+    }
+
+    constexpr next_type next()
+    {
+        if (empty())
+            return nullptr;
+        _current = {&_stream.columns(), _selection.row(_position++)};
+        return &_current;
+    }
+
+    template <std::size_t J, typename Q>
+    constexpr auto where(Q &&q)
+    {
+        pushDown<J>(q);
+        return ColumnFilterStream<ColumnFilterStream, J, Q>{*this, std::forward<Q>(q)};
+    }
+
+    // Hands predicates on to a source that can use them to skip data.
+    template <std::size_t J, typename Q>
+    constexpr void pushDown(Q const &q)
+    {
+        if constexpr (requires { _stream.template pushDown<J>(q); })
+            _stream.template pushDown<J>(q);
+    }
+
+    // Pulls upstream blocks until one keeps a row. Dense blocks are scanned branch-free straight
+    // down the column; selection vectors are narrowed in place, reading only the selected rows.
+    constexpr bool nextBlock(detail::Selection &selection)
+    {
+        auto const &column = std::get<I>(_stream.columns());
+        while (_stream.nextBlock(selection))
+        {
+            std::size_t n = 0;
+            if (selection.dense)
+            {
+                auto const *values = column.data() + selection.begin;
+                selection.rows.resize(selection.end - selection.begin);
+                for (std::size_t k = 0; k < selection.rows.size(); k++)
+                {
+                    selection.rows[n] = static_cast<std::uint32_t>(k);
+                    n += static_cast<bool>(_p(values[k]));
+                }
+                selection.dense = false;
+            }
+            else
+            {
+                for (std::uint32_t offset : selection.rows)
+                {
+                    selection.rows[n] = offset;
+                    n += static_cast<bool>(_p(column[selection.begin + offset]));
+                }
+            }
+            selection.rows.resize(n);
+            if (n)
+                return true;
+        }
+        return false;
+    }
+
+    constexpr auto const &columns() const { return _stream.columns(); }
+
+  private:
+    S &_stream;
+    P _p;
+    detail::Selection _selection;
+    std::size_t _position = 0;
+    value_type _current;
+};
+
+// Predicate lo <= v <= hi with either bound optional. Column file readers recognise it in
+// where<I>() and skip chunks whose zone map lies outside the range.
+template <typename T>
+struct RangePredicate
+{
+    std::optional<T> lo;
+    std::optional<T> hi;
+
+    template <typename U>
+    constexpr bool operator()(U const &v) const { return (!lo || *lo <= v) && (!hi || v <= *hi); }
+};
+
+template <typename T>
+constexpr RangePredicate<T> between(T lo, T hi) { return {lo, hi}; }
+
+template <typename T>
+constexpr RangePredicate<T> atLeast(T lo) { return {lo, std::nullopt}; }
+
+template <typename T>
+constexpr RangePredicate<T> atMost(T hi) { return {std::nullopt, hi}; }
+
+namespace detail
+{
+enum class ColumnEncoding : std::uint8_t
+{
+    plain,
+    bitPacked,
+    delta,
+    dictionary,
+};
+
+// Position, encoding and zone map of one column of one row group.
+template <typename T>
+struct ColumnChunk
+{
+    std::uint64_t offset = 0;
+    std::uint64_t bytes = 0;
+    ColumnEncoding encoding = ColumnEncoding::plain;
+    T min{};
+    T max{};
+};
+
+template <typename... T>
+struct ColumnGroup
+{
+    std::uint64_t rows = 0;
+    std::tuple<ColumnChunk<T>...> chunks;
+};
+
+inline constexpr char columnMagic[4] = {'J', 'S', 'T', 'C'};
+
+template <typename T>
+constexpr std::uint8_t columnKind() { return std::is_floating_point_v<T> ? 'f' : std::is_signed_v<T> ? 's' : 'u'; }
+
+constexpr std::size_t packedWords(std::size_t n, int width) { return (n * width + 63) / 64; }
+
+// Packs value(i) for i in [0, n), `width` bits each, into 64-bit words.
+template <typename F>
+std::vector<std::uint64_t> pack(std::size_t n, int width, F value)
+{
+    std::vector<std::uint64_t> words(packedWords(n, width));
+    for (std::size_t i = 0, bit = 0; width && i < n; i++, bit += width)
+    {
+        std::uint64_t v = value(i);
+        words[bit / 64] |= v << bit % 64;
+        if (bit % 64 + width > 64)
+            words[bit / 64 + 1] |= v >> (64 - bit % 64);
+    }
+    return words;
+}
+
+template <typename F>
+void unpack(std::uint64_t const *words, std::size_t n, int width, F out)
+{
+    std::uint64_t mask = width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+    for (std::size_t i = 0, bit = 0; i < n; i++, bit += width)
+    {
+        std::uint64_t v = 0;
+        if (width)
+        {
+            v = words[bit / 64] >> bit % 64;
+            if (bit % 64 + width > 64)
+                v |= words[bit / 64 + 1] << (64 - bit % 64);
+        }
+        out(i, v & mask);
+    }
+}
+
+template <typename T>
+void writeArray(std::ostream &out, std::vector<T> const &values)
+{
+    out.write(reinterpret_cast<char const *>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+void readArray(std::istream &in, std::vector<T> &values, std::size_t n)
+{
+    values.resize(n);
+    if (!in.read(reinterpret_cast<char *>(values.data()), n * sizeof(T)))
+        throw std::runtime_error("jstream: truncated input");
+}
+
+constexpr std::uint64_t zigzag(std::uint64_t d) { return d << 1 ^ -(d >> 63); }
+constexpr std::uint64_t unzigzag(std::uint64_t z) { return z >> 1 ^ -(z & 1); }
+
+// Writes the payload of one column chunk in the smallest of the encodings that apply: plain
+// values; integers as bit-packed offsets from the chunk minimum or as the first value followed
+// by bit-packed zigzag deltas; and a sorted dictionary with bit-packed codes.
+template <typename T>
+void encodeColumn(std::ostream &out, std::vector<T> const &values, ColumnChunk<T> &chunk)
+{
+    std::size_t n = values.size();
+    bool first = true;
+    for (T const &v : values)
+        if (v == v)
+        {
+            chunk.min = first || v < chunk.min ? v : chunk.min;
+            chunk.max = first || chunk.max < v ? v : chunk.max;
+            first = false;
+        }
+    std::size_t best = n * sizeof(T);
+    chunk.encoding = ColumnEncoding::plain;
+    int forWidth = 0, deltaWidth = 0;
+    if constexpr (std::is_integral_v<T>)
+    {
+        forWidth = std::bit_width(std::uint64_t(chunk.max) - std::uint64_t(chunk.min));
+        std::uint64_t deltas = 0;
+        for (std::size_t i = 1; i < n; i++)
+            deltas |= zigzag(std::uint64_t(values[i]) - std::uint64_t(values[i - 1]));
+        deltaWidth = std::bit_width(deltas);
+        if (std::size_t bytes = 1 + 8 * packedWords(n, forWidth); bytes < best)
+            best = bytes, chunk.encoding = ColumnEncoding::bitPacked;
+        if (std::size_t bytes = sizeof(T) + 1 + 8 * packedWords(n - 1, deltaWidth); bytes < best)
+            best = bytes, chunk.encoding = ColumnEncoding::delta;
+    }
+    std::vector<T> dictionary;
+    if (!first && std::all_of(values.begin(), values.end(), [](T const &v) { return v == v; }))
+    {
+        dictionary = values;
+        std::sort(dictionary.begin(), dictionary.end());
+        dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+        int width = std::bit_width(dictionary.size() - 1);
+        if (std::size_t bytes = 4 + dictionary.size() * sizeof(T) + 1 + 8 * packedWords(n, width); bytes < best)
+            chunk.encoding = ColumnEncoding::dictionary;
+    }
+    switch (chunk.encoding)
+    {
+    case ColumnEncoding::plain:
+        writeArray(out, values);
+        break;
+    case ColumnEncoding::bitPacked:
+        write(out, std::uint8_t(forWidth));
+        writeArray(out, pack(n, forWidth, [&](std::size_t i) { return std::uint64_t(values[i]) - std::uint64_t(chunk.min); }));
+        break;
+    case ColumnEncoding::delta:
+        write(out, values.front());
+        write(out, std::uint8_t(deltaWidth));
+        writeArray(out, pack(n - 1, deltaWidth, [&](std::size_t i) { return zigzag(std::uint64_t(values[i + 1]) - std::uint64_t(values[i])); }));
+        break;
+    case ColumnEncoding::dictionary:
+    {
+        int width = std::bit_width(dictionary.size() - 1);
+        write(out, std::uint32_t(dictionary.size()));
+        writeArray(out, dictionary);
+        write(out, std::uint8_t(width));
+        writeArray(out, pack(n, width, [&](std::size_t i) {
+            return std::uint64_t(std::lower_bound(dictionary.begin(), dictionary.end(), values[i]) - dictionary.begin());
+        }));
+        break;
+    }
+    }
+}
+
+template <typename T>
+void decodeColumn(std::istream &in, ColumnChunk<T> const &chunk, std::size_t n, std::vector<T> &values)
+{
+    if (chunk.encoding == ColumnEncoding::plain)
+        return readArray(in, values, n);
+    values.resize(n);
+    std::vector<std::uint64_t> words;
+    if constexpr (std::is_integral_v<T>)
+    {
+        if (chunk.encoding == ColumnEncoding::bitPacked)
+        {
+            int width = read<std::uint8_t>(in);
+            readArray(in, words, packedWords(n, width));
+            unpack(words.data(), n, width, [&](std::size_t i, std::uint64_t v) { values[i] = T(std::uint64_t(chunk.min) + v); });
+            return;
+        }
+        if (chunk.encoding == ColumnEncoding::delta)
+        {
+            std::uint64_t v = std::uint64_t(values[0] = read<T>(in));
+            int width = read<std::uint8_t>(in);
+            readArray(in, words, packedWords(n - 1, width));
+            unpack(words.data(), n - 1, width, [&](std::size_t i, std::uint64_t z) { values[i + 1] = T(v += unzigzag(z)); });
+            return;
+        }
+    }
+    if (chunk.encoding != ColumnEncoding::dictionary)
+        throw std::runtime_error("jstream: unknown column encoding");
+    std::vector<T> dictionary;
+    readArray(in, dictionary, read<std::uint32_t>(in));
+    int width = read<std::uint8_t>(in);
+    readArray(in, words, packedWords(n, width));
+    unpack(words.data(), n, width, [&](std::size_t i, std::uint64_t code) { values[i] = dictionary.at(code); });
+}
+} // namespace detail
+
+// Sink for the column file format: rows are buffered into row groups of chunkRows rows, each
+// written column by column in its own encoding, and close() appends a footer with every chunk's
+// offset and min/max zone map followed by the footer offset and the magic. close() throws if the
+// stream failed; the destructor closes an open writer but swallows that error.
+template <typename... T>
+class ColumnFileWriter
 {
-  private:
-    auto &impl() { return *static_cast<CRTP *>(this); }
-    auto next() { return impl().next(); }
+    static_assert((std::is_arithmetic_v<T> && ...), "column files hold arithmetic columns");
 
   public:
-    using base_type = Stream<CRTP>;
+    explicit ColumnFileWriter(std::ostream &out, std::size_t chunkRows = 65536) : _out(out), _origin(out.tellp()), _chunkRows(std::max<std::size_t>(chunkRows, 1))
+    {
+        _out.write(detail::columnMagic, sizeof detail::columnMagic);
+        detail::write(_out, std::uint32_t(sizeof...(T)));
+        ((detail::write(_out, detail::columnKind<T>()), detail::write(_out, std::uint8_t(sizeof(T)))), ...);
+    }
 
-    template <typename F>
-    constexpr auto filter(F &&f) { return FilterStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+    ColumnFileWriter(ColumnFileWriter const &) = delete;
+    ColumnFileWriter &operator=(ColumnFileWriter const &) = delete;
 
-    template <typename F>
-    constexpr auto map(F &&f) { return TransformStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+    ~ColumnFileWriter()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
 
-    template <typename F>
-    constexpr auto flatMap(F &&f) { return FlatStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+    void append(T const &...values)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>) { (std::get<I>(_buffers).push_back(values), ...); }(std::index_sequence_for<T...>{});
+        if (std::get<0>(_buffers).size() == _chunkRows)
+            flush();
+    }
 
-    template<typename F>
-    constexpr auto peek(F &&f) { return PeekStream<CRTP, F>{impl(), std::forward<F>(f)}; }
+    void close()
+    {
+        if (_closed)
+            return;
+        _closed = true;
+        flush();
+        std::uint64_t footer = offset();
+        detail::write(_out, std::uint64_t(_groups.size()));
+        for (detail::ColumnGroup<T...> const &group : _groups)
+        {
+            detail::write(_out, group.rows);
+            std::apply([&](auto const &...chunk) { (writeChunk(chunk), ...); }, group.chunks);
+        }
+        detail::write(_out, footer);
+        _out.write(detail::columnMagic, sizeof detail::columnMagic);
+        if (!_out.flush())
+            throw std::runtime_error("jstream: failed to write column file");
+    }
 
-    constexpr auto limit(std::size_t n) { return LimitStream<CRTP>{impl(), n}; };
+  private:
+    std::uint64_t offset() { return std::uint64_t(_out.tellp() - _origin); }
 
-    template <typename F>
-    constexpr void forEach(F &&f)
+    void flush()
     {
-        while (!empty())
-            std::forward<F>(f)(*next());
+        if (std::get<0>(_buffers).empty())
+            return;
+        detail::ColumnGroup<T...> &group = _groups.emplace_back();
+        group.rows = std::get<0>(_buffers).size();
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            ((std::get<I>(group.chunks).offset = offset(), detail::encodeColumn(_out, std::get<I>(_buffers), std::get<I>(group.chunks)),
+              std::get<I>(group.chunks).bytes = offset() - std::get<I>(group.chunks).offset, std::get<I>(_buffers).clear()),
+             ...);
+        }(std::index_sequence_for<T...>{});
     }
 
-    constexpr std::size_t count()
+    template <typename U>
+    void writeChunk(detail::ColumnChunk<U> const &chunk)
     {
-        std::size_t count = 0;
-        while (!empty())
+        detail::write(_out, chunk.offset);
+        detail::write(_out, chunk.bytes);
+        detail::write(_out, chunk.encoding);
+        detail::write(_out, chunk.min);
+        detail::write(_out, chunk.max);
+    }
+
+    std::ostream &_out;
+    std::ostream::pos_type _origin;
+    std::size_t _chunkRows;
+    std::tuple<std::vector<T>...> _buffers;
+    std::vector<detail::ColumnGroup<T...>> _groups;
+    bool _closed = false;
+};
+
+// Source over a column file, yielding ColumnRow proxies over one decoded row group at a time.
+// where<I>(p) filters like on columns(); when p is a RangePredicate it is also pushed down, and
+// row groups whose zone map for column I excludes the range are never read or decoded.
+template <typename... T>
+class ColumnFileStream : public Stream<ColumnFileStream<T...>>
+{
+  public:
+    using value_type = ColumnRow<T...>;
+    using next_type = value_type *;
+    using columns_type = typename value_type::columns_type;
+
+    explicit ColumnFileStream(std::istream &in) : _in(in), _origin(in.tellg())
+    {
+        char magic[sizeof detail::columnMagic];
+        if (!_in.read(magic, sizeof magic) || !std::equal(magic, magic + sizeof magic, detail::columnMagic))
+            throw std::runtime_error("jstream: not a column file");
+        if (detail::read<std::uint32_t>(_in) != sizeof...(T) ||
+            !((detail::read<std::uint8_t>(_in) == detail::columnKind<T>() && detail::read<std::uint8_t>(_in) == sizeof(T)) && ...))
+            throw std::runtime_error("jstream: column file schema mismatch");
+        // Check the trailer and the footer's extent before trusting any offset in it.
+        std::uint64_t header = sizeof magic + sizeof(std::uint32_t) + 2 * sizeof...(T);
+        std::uint64_t trailer = sizeof(std::uint64_t) + sizeof magic;
+        std::uint64_t groupBytes = sizeof(std::uint64_t) + ((2 * sizeof(std::uint64_t) + sizeof(detail::ColumnEncoding) + 2 * sizeof(T)) + ...);
+        _in.seekg(0, std::ios::end);
+        std::uint64_t size = std::uint64_t(_in.tellg() - _origin);
+        if (!_in || size < header + sizeof(std::uint64_t) + trailer)
+            throw std::runtime_error("jstream: truncated column file");
+        _in.seekg(_origin + std::streamoff(size - trailer));
+        std::uint64_t footer = detail::read<std::uint64_t>(_in);
+        if (!_in.read(magic, sizeof magic) || !std::equal(magic, magic + sizeof magic, detail::columnMagic))
+            throw std::runtime_error("jstream: truncated column file");
+        if (footer < header || footer > size - trailer - sizeof(std::uint64_t))
+            throw std::runtime_error("jstream: corrupt column file footer");
+        _in.seekg(_origin + std::streamoff(footer));
+        std::uint64_t groups = detail::read<std::uint64_t>(_in);
+        if (groups != (size - trailer - footer - sizeof(std::uint64_t)) / groupBytes ||
+            (size - trailer - footer - sizeof(std::uint64_t)) % groupBytes)
+            throw std::runtime_error("jstream: corrupt column file footer");
+        _groups.resize(groups);
+        for (detail::ColumnGroup<T...> &group : _groups)
         {
-            count++;
-            next();
+            group.rows = detail::read<std::uint64_t>(_in);
+            std::apply([&](auto &...chunk) { (readChunk(chunk, header, footer), ...); }, group.chunks);
         }
-        return count;
     }
 
-    constexpr auto sum()
+    bool empty()
     {
-        typename CRTP::value_type sum{};
-        while (!empty())
-            sum += *next();
-        return sum;
+        while (_position == _rows)
+            if (!load())
+                return true;
+        return false;
     }
 
-    template <typename F>
-    constexpr bool allMatch(F &&f)
+    next_type next()
     {
-        bool ret = true;
-        while (!empty())
-            ret &= std::forward<F>(f)(*next());
-        return ret;
+        if (empty())
+            return nullptr;
+        _current = {&_columns, _position++};
+        return &_current;
     }
 
-    template <typename F>
-    constexpr bool anyMatch(F &&f)
+    template <std::size_t I, typename P>
+    auto where(P &&p)
     {
-        while (!empty())
-            if (std::forward<F>(f)(*next()))
-                return true;
-        return false;
+        pushDown<I>(p);
+        return ColumnFilterStream<ColumnFileStream, I, P>{*this, std::forward<P>(p)};
     }
 
-    template <typename F>
-    constexpr bool noneMatch(F &&f)
+    template <std::size_t I, typename P>
+    void pushDown(P const &p)
     {
-        bool ret = true;
-        while (!empty())
-            ret &= !std::forward<F>(f)(*next());
-        return ret;
+        if constexpr (requires { p.lo, p.hi; })
+            _skips.push_back([p](detail::ColumnGroup<T...> const &group) {
+                auto const &chunk = std::get<I>(group.chunks);
+                return (p.hi && *p.hi < chunk.min) || (p.lo && chunk.max < *p.lo);
+            });
     }
 
-    constexpr bool empty() {
-        return impl().empty();
+    bool nextBlock(detail::Selection &selection)
+    {
+        _position = _rows;
+        if (!load())
+            return false;
+        selection.begin = 0;
+        selection.end = _position = _rows;
+        selection.dense = true;
+        return true;
+    }
+
+    columns_type const &columns() const { return _columns; }
+
+    // Row groups passed over on their zone maps so far.
+    std::size_t skippedChunks() const { return _skipped; }
+
+  private:
+    template <typename U>
+    void readChunk(detail::ColumnChunk<U> &chunk, std::uint64_t begin, std::uint64_t end)
+    {
+        chunk.offset = detail::read<std::uint64_t>(_in);
+        chunk.bytes = detail::read<std::uint64_t>(_in);
+        chunk.encoding = detail::read<detail::ColumnEncoding>(_in);
+        chunk.min = detail::read<U>(_in);
+        chunk.max = detail::read<U>(_in);
+        if (chunk.offset < begin || chunk.offset > end || chunk.bytes > end - chunk.offset)
+            throw std::runtime_error("jstream: corrupt column file footer");
     }
+
+    // Decodes the next row group that survives every pushed down range.
+    bool load()
+    {
+        for (; _group < _groups.size(); _group++)
+        {
+            detail::ColumnGroup<T...> const &group = _groups[_group];
+            if (std::any_of(_skips.begin(), _skips.end(), [&](auto const &skip) { return skip(group); }))
+            {
+                _skipped++;
+                continue;
+            }
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((_in.seekg(_origin + std::streamoff(std::get<I>(group.chunks).offset)),
+                  detail::decodeColumn(_in, std::get<I>(group.chunks), group.rows, std::get<I>(_data)),
+                  std::get<I>(_columns) = std::get<I>(_data)),
+                 ...);
+            }(std::index_sequence_for<T...>{});
+            _rows = group.rows;
+            _position = 0;
+            _group++;
+            return true;
+        }
+        return false;
+    }
+
+    std::istream &_in;
+    std::istream::pos_type _origin;
+    std::vector<detail::ColumnGroup<T...>> _groups;
+    std::vector<std::function<bool(detail::ColumnGroup<T...> const &)>> _skips;
+    std::tuple<std::vector<T>...> _data;
+    columns_type _columns;
+    std::size_t _group = 0;
+    std::size_t _rows = 0;
+    std::size_t _position = 0;
+    std::size_t _skipped = 0;
+    value_type _current;
 };
 
-template <typename S, typename F>
-class FilterStream : public Stream<FilterStream<S, F>>
+enum class IntegerCodec : std::uint8_t
 {
-  public:
-    using next_type = typename S::next_type;
-    using value_type = typename S::value_type;
+    streamVByte,
+    bitPacked,
+};
 
-    constexpr FilterStream(S &s, F f) : _stream(s), _f(f) {}
+namespace detail
+{
+// Stream VByte keeps the 2-bit byte lengths of four values in one control byte, apart from the
+// value bytes, so a decoder can expand four values with one table-driven byte shuffle.
+struct VByteTables
+{
+    std::array<std::array<std::uint8_t, 16>, 256> shuffle{};
+    std::array<std::uint8_t, 256> length{};
+};
 
-    constexpr next_type next()
+inline constexpr VByteTables vbyteTables = [] {
+    VByteTables tables;
+    for (std::size_t control = 0; control < 256; control++)
     {
-        if (_next)
+        std::uint8_t offset = 0;
+        for (std::size_t j = 0; j < 4; j++)
         {
-            next_type ret = nullptr;
-            std::swap(ret, _next);
-            return ret;
+            std::size_t length = (control >> 2 * j & 3) + 1;
+            for (std::size_t k = 0; k < 4; k++)
+                tables.shuffle[control][4 * j + k] = k < length ? std::uint8_t(offset + k) : 0x80;
+            offset += std::uint8_t(length);
         }
-        while (!empty()) {
-            next_type n = _stream.next();
-            if (_f(*n))
-                return n;
-        }
-        return nullptr;
+        tables.length[control] = offset;
     }
+    return tables;
+}();
 
-    constexpr bool empty() {
-        while (!_stream.empty()) {
-            _next = _stream.next();
-            if (_f(*_next))
-                return false;
+// Decodes n values (a multiple of four) and returns the end of their data bytes. The data must
+// be followed by 16 readable bytes for the SSSE3 path.
+inline std::uint8_t const *decodeVByte(std::uint8_t const *control, std::uint8_t const *data, std::uint32_t *out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += 4)
+    {
+        std::uint8_t c = control[i / 4];
+#if JSTREAM_HAS_SSSE3
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<__m128i const *>(vbyteTables.shuffle[c].data()));
+        __m128i values = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(data)), shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), values);
+#else
+        std::uint8_t const *bytes = data;
+        for (std::size_t j = 0; j < 4; j++)
+        {
+            std::uint32_t v = 0;
+            for (std::size_t k = 0, length = (c >> 2 * j & 3) + 1; k < length; k++)
+                v |= std::uint32_t(*bytes++) << 8 * k;
+            out[i + j] = v;
         }
-        return true;
+#endif
+        data += vbyteTables.length[c];
     }
+    return data;
+}
+} // namespace detail
 
-  private:
-    S &_stream;
-    F _f;
-    next_type _next;
-};
-
-template <typename S, typename F>
-class TransformStream : public Stream<TransformStream<S, F>>
+// Append-only compressed list of 32-bit integers. Values are encoded in blocks of 128, with
+// Stream VByte or bit-packing at the block's widest value, optionally as deltas from the
+// previous value, which suits sorted ID lists. Each block header keeps its first value and data
+// offset, so sorted lists can seek by binary search over headers; the last partial block stays
+// uncompressed until it fills.
+class CompressedIntegers
 {
   public:
-    using next_type = std::invoke_result_t<F, decltype(* typename S::next_type{})> *;
-    using value_type = std::remove_cv_t<std::remove_pointer_t<next_type>>;
+    static constexpr std::size_t block = 128;
 
-    constexpr TransformStream(S &s, F f) : _stream(s), _f(f) {}
+    struct Header
+    {
+        std::uint32_t first;
+        std::size_t offset;
+    };
 
-    constexpr next_type next()
+    explicit CompressedIntegers(IntegerCodec codec = IntegerCodec::streamVByte, bool delta = false) : _codec(codec), _delta(delta) {}
+
+    void push_back(std::uint32_t value)
     {
-        if (!empty()) {
-            _currentElement = _f(*_stream.next());
-            return &_currentElement;
-        } else {
-            return nullptr;
+        _sorted &= _size == 0 || _last <= value;
+        _last = value;
+        _size++;
+        _tail.push_back(value);
+        if (_tail.size() == block)
+        {
+            encode();
+            _tail.clear();
         }
     }
 
-    constexpr bool empty() { return _stream.empty(); }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
 
-  private:
-    S &_stream;
-    F _f;
-    value_type _currentElement;
-};
+    // Whether values were appended in non-decreasing order, which seeking relies on.
+    bool sorted() const { return _sorted; }
 
-template <typename S, typename F>
-class FlatStream : public Stream<FlatStream<S, F>>
-{
-  public:
-    using substream_next_type = std::invoke_result_t<decltype(&S::next), S*>;
-    using flat_stream_type = std::invoke_result_t<F, decltype(*substream_next_type{})>;
-    using next_type = std::invoke_result_t<decltype(&flat_stream_type::next), flat_stream_type*>;
-    using value_type = std::remove_cv_t<std::remove_pointer_t<next_type>>;
+    // Bytes held, headers and the uncompressed tail included.
+    std::size_t bytes() const { return _data.size() + _headers.size() * sizeof(Header) + _tail.size() * sizeof(std::uint32_t); }
 
-    constexpr FlatStream(S &s, F f) : _stream(s), _f(f) {}
+    std::span<Header const> headers() const { return _headers; }
+    std::span<std::uint32_t const> tail() const { return _tail; }
 
-    constexpr next_type next(bool force = false)
+    // Decodes full block b into out[0, block).
+    void decode(std::size_t b, std::uint32_t *out) const
     {
-        if (!_currentFlatStream || force)
+        std::uint8_t const *data = _data.data() + _headers[b].offset;
+        std::uint32_t deltas[block];
+        std::uint32_t *codes = _delta ? deltas : out;
+        if (_codec == IntegerCodec::streamVByte)
+            detail::decodeVByte(data, data + block / 4, codes, block);
+        else
         {
-            if (!_stream.empty())
-                _currentFlatStream = _f(*_stream.next());
-            else
-                return nullptr;
+            int width = *data;
+            std::uint64_t words[block / 2];
+            std::memcpy(words, data + 1, detail::packedWords(block, width) * sizeof(std::uint64_t));
+            detail::unpack(words, block, width, [&](std::size_t i, std::uint64_t v) { codes[i] = std::uint32_t(v); });
+        }
+        if (_delta)
+        {
+            std::plus<std::uint32_t> add;
+            detail::prefixScan(deltas, out, block, add, _headers[b].first);
         }
-        return _currentFlatStream->empty() ? next(true) : _currentFlatStream->next();
     }
 
-    constexpr bool empty() { return _stream.empty() && (!_currentFlatStream || _currentFlatStream->empty()); }
-
   private:
-    S &_stream;
-    F _f;
-    std::optional<flat_stream_type> _currentFlatStream;
+    static constexpr std::size_t padding = 16;
+
+    void encode()
+    {
+        std::uint32_t codes[block];
+        for (std::size_t i = 0; i < block; i++)
+            codes[i] = _delta ? _tail[i] - (i ? _tail[i - 1] : _tail[0]) : _tail[i];
+        _data.resize(_data.size() - std::min(_data.size(), padding));
+        _headers.push_back({_tail[0], _data.size()});
+        if (_codec == IntegerCodec::streamVByte)
+        {
+            std::size_t control = _data.size();
+            _data.resize(control + block / 4);
+            for (std::size_t i = 0; i < block; i++)
+            {
+                std::size_t length = codes[i] < 1u << 8 ? 1 : codes[i] < 1u << 16 ? 2 : codes[i] < 1u << 24 ? 3 : 4;
+                _data[control + i / 4] |= std::uint8_t((length - 1) << 2 * (i % 4));
+                for (std::size_t k = 0; k < length; k++)
+                    _data.push_back(std::uint8_t(codes[i] >> 8 * k));
+            }
+        }
+        else
+        {
+            int width = std::bit_width(std::accumulate(codes, codes + block, std::uint32_t{0}, std::bit_or<>{}));
+            std::vector<std::uint64_t> words = detail::pack(block, width, [&](std::size_t i) { return codes[i]; });
+            _data.push_back(std::uint8_t(width));
+            _data.insert(_data.end(), reinterpret_cast<std::uint8_t const *>(words.data()), reinterpret_cast<std::uint8_t const *>(words.data() + words.size()));
+        }
+        _data.resize(_data.size() + padding);
+    }
+
+    IntegerCodec _codec;
+    bool _delta;
+    bool _sorted = true;
+    std::uint32_t _last = 0;
+    std::size_t _size = 0;
+    std::vector<Header> _headers;
+    std::vector<std::uint8_t> _data;
+    std::vector<std::uint32_t> _tail;
 };
 
-template<typename S, typename F>
-class PeekStream : public Stream<PeekStream<S, F>>
+// Decodes a CompressedIntegers block by block as elements are pulled. skipTo on a sorted list
+// binary searches the block headers and decodes only the block it lands in.
+class CompressedStream : public Stream<CompressedStream>
 {
   public:
-    using next_type = typename S::next_type;
-    using value_type = typename S::value_type;
+    using value_type = std::uint32_t;
+    using next_type = value_type const *;
 
-    constexpr PeekStream(S &s, F f) : _stream(s), _f(f) {}
+    explicit CompressedStream(CompressedIntegers const &list) : _list(list) {}
 
-    constexpr next_type next() {
-        next_type n = _stream.next();
-        if (n)
-            _f(*n);
-        return n;
+    bool empty() { return _position == _count && !load(_block); }
+
+    next_type next()
+    {
+        if (empty())
+            return nullptr;
+        return &_values[_position++];
     }
 
-    constexpr bool empty() { return _stream.empty(); }
+    template <typename K, typename Cmp = std::less<>>
+    void skipTo(K const &key, Cmp cmp = {})
+    {
+        if constexpr (std::is_same_v<Cmp, std::less<>> || std::is_same_v<Cmp, std::less<value_type>>)
+        {
+            // A negative key is before every element; comparing it as unsigned would skip them all.
+            if constexpr (std::is_signed_v<K>)
+                if (key < 0)
+                    return;
+            auto headers = _list.headers();
+            auto tail = _list.tail();
+            if (_list.sorted() && _block <= headers.size() && (_position == _count || cmp(_values[_count - 1], key)))
+            {
+                std::size_t b = std::partition_point(headers.begin() + _block, headers.end(), [&](auto const &h) { return cmp(h.first, key); }) - headers.begin();
+                if (b == headers.size() && !tail.empty() && cmp(tail.front(), key))
+                    load(b);
+                else if (b > _block)
+                    load(b - 1);
+            }
+        }
+        while (!empty() && cmp(_values[_position], key))
+            _position++;
+    }
 
   private:
-    S &_stream;
-    F _f;
+    bool load(std::size_t b)
+    {
+        if (b < _list.headers().size())
+        {
+            _list.decode(b, _buffer);
+            _values = _buffer;
+            _count = CompressedIntegers::block;
+        }
+        else if (b == _list.headers().size() && !_list.tail().empty())
+        {
+            _values = _list.tail().data();
+            _count = _list.tail().size();
+        }
+        else
+            return false;
+        _block = b + 1;
+        _position = 0;
+        return true;
+    }
+
+    CompressedIntegers const &_list;
+    std::uint32_t _buffer[CompressedIntegers::block];
+    value_type const *_values = nullptr;
+    std::size_t _block = 0;
+    std::size_t _count = 0;
+    std::size_t _position = 0;
 };
 
-template <typename S>
-class LimitStream : public Stream<LimitStream<S>>
+struct CompressingAggregator
+{
+    IntegerCodec codec;
+    bool delta;
+
+    template <typename T>
+    struct accumulator
+    {
+        CompressedIntegers list;
+
+        void accumulate(T const &t) { list.push_back(static_cast<std::uint32_t>(t)); }
+        CompressedIntegers const &result() const { return list; }
+        void merge(accumulator const &other)
+        {
+            CompressedStream s(other.list);
+            while (!s.empty())
+                list.push_back(*s.next());
+        }
+    };
+
+    template <typename T>
+    accumulator<T> bind() const { return {CompressedIntegers{codec, delta}}; }
+};
+
+// Collects 32-bit integers into a CompressedIntegers; delta suits sorted input.
+inline CompressingAggregator compressing(IntegerCodec codec = IntegerCodec::streamVByte, bool delta = false) { return {codec, delta}; }
+
+// Ascending source over a RoaringBitmap. Bitmap containers are walked a word at a time with
+// count-trailing-zeros (tzcnt); skipTo binary searches the container keys and then seeks inside
+// the one container it lands in.
+class BitmapStream : public Stream<BitmapStream>
 {
   public:
-    using next_type = typename S::next_type;
-    using value_type = typename S::value_type;
+    using value_type = std::uint32_t;
+    using next_type = value_type const *;
+    static constexpr bool sorted = true;
 
-    constexpr LimitStream(S &s, std::size_t n) : _stream(s), _n(n) {}
+    explicit BitmapStream(RoaringBitmap const &bitmap) : _bitmap(bitmap) { seek(0, 0); }
 
-    constexpr next_type next()
+    bool empty() { return _container == _bitmap._keys.size(); }
+
+    next_type next()
     {
-        if (_n > 0 && !_stream.empty())
+        if (empty())
+            return nullptr;
+        _currentElement = current();
+        seek(_container, _low + 1);
+        return &_currentElement;
+    }
+
+    template <typename K, typename Cmp = std::less<>>
+    void skipTo(K const &key, Cmp cmp = {})
+    {
+        if constexpr (std::is_integral_v<K> && (std::is_same_v<Cmp, std::less<>> || std::is_same_v<Cmp, std::less<value_type>>))
         {
-            _n--;
-            return _stream.next();
+            // Compares as integers, so a negative key is before every element rather than after.
+            if (empty() || !std::cmp_less(current(), key))
+                return;
+            if (std::cmp_greater(key, std::numeric_limits<value_type>::max()))
+            {
+                _container = _bitmap._keys.size();
+                return;
+            }
+            std::uint32_t target = static_cast<std::uint32_t>(key);
+            auto keys = _bitmap._keys.begin();
+            std::size_t c = std::lower_bound(keys + _container, _bitmap._keys.end(), std::uint16_t(target >> 16)) - keys;
+            seek(c, c < _bitmap._keys.size() && keys[c] == target >> 16 ? target & 0xffff : 0);
+        }
+        else
+        {
+            while (!empty() && cmp(current(), key))
+                next();
         }
-        return nullptr;
     }
 
-    constexpr bool empty() { return _n <= 0 || _stream.empty(); }
-
   private:
-    S &_stream;
-    std::size_t _n;
+    value_type current() const { return std::uint32_t(_bitmap._keys[_container]) << 16 | _low; }
+
+    // Moves to the first element of container c, or a later one, not less than low.
+    void seek(std::size_t c, std::uint32_t low)
+    {
+        if (c != _container)
+            _hint = 0;
+        for (; c < _bitmap._keys.size(); c++, low = 0, _hint = 0)
+            if ((_low = _bitmap._containers[c].first(low, _hint)) != RoaringBitmap::none)
+                break;
+        _container = c;
+    }
+
+    RoaringBitmap const &_bitmap;
+    std::size_t _container = -1;
+    std::size_t _hint = 0;
+    std::uint32_t _low = 0;
+    value_type _currentElement = 0;
 };
 
 template <typename InputIt>
@@ -261,6 +5965,19 @@ class IteratorStream : public Stream<IteratorStream<InputIt>>
 
     constexpr next_type next() { return &*_begin++; }
 
+    constexpr std::size_t size() requires std::random_access_iterator<InputIt> { return _end - _begin; }
+    constexpr decltype(auto) at(std::size_t i) requires std::random_access_iterator<InputIt> { return _begin[i]; }
+    constexpr void skip(std::size_t n) requires std::random_access_iterator<InputIt> { _begin += n; }
+    constexpr next_type data() requires std::contiguous_iterator<InputIt> { return std::to_address(_begin); }
+
+    template <typename K, typename Cmp = std::less<>>
+        requires std::random_access_iterator<InputIt>
+    constexpr void skipTo(K const &key, Cmp cmp = {})
+    {
+        auto less = [&](auto const &v) { return cmp(v, key); };
+        skip(detail::gallop(*this, less));
+    }
+
   private:
     InputIt _begin;
     InputIt _end;
@@ -286,10 +6003,91 @@ auto of(C &c) { return ContainerStream<C>{c}; }
 template<typename T, std::size_t N>
 auto of(T (&arr)[N]) { return ArrayStream<T, N>{arr}; }
 
+inline auto of(RoaringBitmap const &bitmap) { return BitmapStream{bitmap}; }
+
+inline auto of(RoaringBitmap &bitmap) { return BitmapStream{bitmap}; }
+
+inline auto of(CompressedIntegers const &list) { return CompressedStream{list}; }
+
+inline auto of(CompressedIntegers &list) { return CompressedStream{list}; }
+
 template<typename InputIt>
 auto of(InputIt beg, InputIt end) { return IteratorStream<InputIt>{beg, end}; } 
 
 template<typename T>
 auto of(std::initializer_list<T> const &list) { return of(std::begin(list), std::end(list)); }
 
-} // namespace jstream
\ No newline at end of file
+// Streams the rows of a table stored as separate contiguous columns; the shortest column bounds
+// the table.
+template <typename... C>
+constexpr auto columns(C const &...c)
+{
+    return ColumnStream<std::remove_cvref_t<decltype(*std::data(c))>...>{std::span{std::data(c), std::size(c)}...};
+}
+
+// Reads a file written by ColumnFileWriter or Stream::writeColumns with columns of types T...
+template <typename... T>
+auto readColumns(std::istream &in) { return ColumnFileStream<T...>{in}; }
+
+template <typename... S>
+constexpr auto zip(S &&...s) { return ZipStream<std::remove_reference_t<S>...>{s...}; }
+
+template <typename F, typename... S>
+constexpr auto zipWith(F &&f, S &&...s) { return ZipWithStream<F, std::remove_reference_t<S>...>{std::forward<F>(f), s...}; }
+
+namespace detail
+{
+template <typename Cmp, typename Refs, std::size_t... I>
+constexpr auto mergeSorted(Cmp cmp, Refs refs, std::index_sequence<I...>)
+{
+    return MergeSortedStream<Cmp, std::remove_reference_t<std::tuple_element_t<I, Refs>>...>{cmp, std::get<I>(refs)...};
+}
+} // namespace detail
+
+// mergeSorted(a, b, ..., cmp) merges streams sorted by cmp, which defaults to std::less<>. Only
+// merges under std::less<> count as SortedStream, which promises ascending order.
+template <typename First, typename... Rest>
+    requires BasicStream<std::remove_cvref_t<First>>
+constexpr auto mergeSorted(First &&first, Rest &&...rest)
+{
+    auto refs = std::tie(first, rest...);
+    constexpr std::size_t n = 1 + sizeof...(Rest);
+    if constexpr (BasicStream<std::remove_cvref_t<std::tuple_element_t<n - 1, decltype(refs)>>>)
+        return detail::mergeSorted(std::less<>{}, refs, std::make_index_sequence<n>{});
+    else
+        return detail::mergeSorted(std::get<n - 1>(refs), refs, std::make_index_sequence<n - 1>{});
+}
+
+template <typename S, typename Cmp = std::less<>>
+constexpr auto mergeSorted(std::vector<S> &streams, Cmp cmp = {}) { return DynamicMergeSortedStream<S, Cmp>{streams, cmp}; }
+
+template <typename A, typename B, typename Cmp = std::less<>>
+constexpr auto intersectSorted(A &&a, B &&b, Cmp cmp = {})
+{
+    return IntersectSortedStream<std::remove_reference_t<A>, std::remove_reference_t<B>, Cmp>{a, b, cmp};
+}
+
+template <typename A, typename B, typename Cmp = std::less<>>
+constexpr auto unionSorted(A &&a, B &&b, Cmp cmp = {})
+{
+    return UnionSortedStream<std::remove_reference_t<A>, std::remove_reference_t<B>, Cmp>{a, b, cmp};
+}
+
+template <typename A, typename B, typename Cmp = std::less<>>
+constexpr auto differenceSorted(A &&a, B &&b, Cmp cmp = {})
+{
+    return DifferenceSortedStream<std::remove_reference_t<A>, std::remove_reference_t<B>, Cmp>{a, b, cmp};
+}
+
+} // namespace jstream
+
+template <typename... T>
+struct std::tuple_size<jstream::ColumnRow<T...>> : std::integral_constant<std::size_t, sizeof...(T)>
+{
+};
+
+template <std::size_t I, typename... T>
+struct std::tuple_element<I, jstream::ColumnRow<T...>>
+{
+    using type = std::tuple_element_t<I, std::tuple<T...>> const &;
+};
\ No newline at end of file
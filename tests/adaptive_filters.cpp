@@ -0,0 +1,46 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+int main()
+{
+    std::vector<int> v(1 << 20);
+    for (std::size_t i = 0; i < v.size(); i++)
+        v[i] = int(i * 2654435761u % 100000);
+    auto slow = [](int x) {
+        double d = x;
+        for (int k = 0; k < 40; k++)
+            d = std::sqrt(d + k);
+        return d > 0;
+    };
+    auto half = [](int x) { return x % 2 == 0; };
+    auto rare = [](int x) { return x % 100 == 0; };
+
+    std::size_t expected = jstream::of(v).filter(slow).filter(half).filter(rare).count();
+
+    // The expensive, unselective predicate moves last.
+    auto src = jstream::of(v);
+    auto adaptive = src.adaptiveFilters(slow, half, rare);
+    CHECK(adaptive.count() == expected);
+    CHECK(adaptive.order()[2] == 0);
+
+    auto fixedSrc = jstream::of(v);
+    auto fixed = fixedSrc.adaptiveFilters(jstream::fixedOrder, slow, half, rare);
+    CHECK(fixed.count() == expected);
+    CHECK((fixed.order() == std::array<std::size_t, 3>{0, 1, 2}));
+
+    std::vector<int> out, ref;
+    jstream::of(v).limit(1000).adaptiveFilters(half, rare).forEach([&](int x) { out.push_back(x); });
+    jstream::of(v).limit(1000).filter(half).filter(rare).forEach([&](int x) { ref.push_back(x); });
+    CHECK(out == ref);
+
+    // With a fixed order an earlier predicate may guard a later one.
+    std::vector<int> divisors{0, 1, 2, 0, 4};
+    CHECK(jstream::of(divisors).adaptiveFilters(jstream::fixedOrder, [](int d) { return d != 0; }, [](int d) { return 8 / d > 2; }).count() == 2);
+
+    std::vector<int> none;
+    CHECK(jstream::of(none).adaptiveFilters(half).count() == 0);
+}
@@ -0,0 +1,38 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <list>
+#include <random>
+#include <vector>
+
+int main()
+{
+    std::vector<int> v{4, 8, 15, 16, 23, 42};
+    auto [n, sum, max, any, all, none, first] = jstream::of(v).aggregate(
+        jstream::count(), jstream::sum(), jstream::max(), jstream::anyMatch([](int x) { return x > 10; }),
+        jstream::allMatch([](int x) { return x > 0; }), jstream::noneMatch([](int x) { return x == 16; }), jstream::findFirst());
+    CHECK(n == 6 && sum == 108 && *max == 42 && any && all && !none && *first == 4);
+
+    // Traversal stops once every aggregator is settled.
+    int pulled = 0;
+    auto [found, head] = jstream::of(v)
+                             .peek([&](int) { pulled++; })
+                             .aggregate(jstream::anyMatch([](int x) { return x == 15; }), jstream::findFirst());
+    CHECK(found && *head == 4 && pulled == 3);
+
+    std::vector<int> empty;
+    auto [emptyAny, emptyAll, emptyNone, emptyFirst] = jstream::of(empty).aggregate(
+        jstream::anyMatch([](int) { return true; }), jstream::allMatch([](int) { return false; }),
+        jstream::noneMatch([](int) { return true; }), jstream::findFirst());
+    CHECK(!emptyAny && emptyAll && emptyNone && !emptyFirst);
+
+    // One pass gives the same answers as separate terminals.
+    std::mt19937 rng(38);
+    std::list<long> l(10000);
+    for (auto &x : l)
+        x = long(rng() % 1000) - 500;
+    auto [stats, count, min, total] = jstream::of(l).aggregate(jstream::summarizing(), jstream::count(), jstream::min(), jstream::sum());
+    CHECK(count == l.size() && stats.count() == l.size());
+    CHECK(*min == stats.min() && total == stats.sum());
+    CHECK(total == jstream::of(l).sum());
+}
@@ -0,0 +1,91 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+int main()
+{
+    std::vector<long> v(1000000);
+    for (long i = 0; i < long(v.size()); i++)
+        v[i] = i;
+    long expected = 0;
+    for (long x : v)
+        expected += x * 3;
+    CHECK(jstream::of(v).map([](long x) { return x * 3; }).async(256, 16).sum() == expected);
+    CHECK(jstream::of(v).limit(10000).async(1, 100).count() == 10000);
+
+    std::thread::id consumer = std::this_thread::get_id(), producer;
+    jstream::of(v).limit(1).peek([&](long) { producer = std::this_thread::get_id(); }).async().count();
+    CHECK(producer != consumer);
+
+    bool threw = false;
+    try
+    {
+        jstream::of(v)
+            .map([](long x) {
+                if (x == 500)
+                    throw std::runtime_error("boom");
+                return x;
+            })
+            .async()
+            .count();
+    }
+    catch (std::runtime_error const &)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+
+    std::vector<std::string> words{"a", "b", "c"};
+    std::string joined;
+    jstream::of(words).async(2, 1).forEach([&](std::string const &x) { joined += x; });
+    CHECK(joined == "abc");
+    std::vector<int> empty;
+    CHECK(jstream::of(empty).async().count() == 0);
+
+    // Consumers that stop early cancel a slow producer while the stage is still alive.
+    auto cancelledAfter = [&](auto stop) {
+        std::atomic<int> produced{0};
+        auto source = jstream::of(v);
+        auto slow = source.map([&](long x) {
+            produced++;
+            std::this_thread::sleep_for(200us);
+            return x;
+        });
+        auto async = slow.async(4096, 64);
+        stop(async);
+        std::this_thread::sleep_for(50ms);
+        return produced.load();
+    };
+    CHECK(cancelledAfter([](auto &s) { CHECK(s.limit(5).count() == 5); }) < 20);
+    CHECK(cancelledAfter([](auto &s) { CHECK(s.takeWhile([](long x) { return x < 5; }).count() == 5); }) < 20);
+    CHECK(cancelledAfter([](auto &s) { CHECK(s.anyMatch([](long x) { return x == 3; })); }) < 20);
+    CHECK(cancelledAfter([](auto &s) { CHECK(*s.findFirst() == 0); }) < 20);
+
+    // A slow producer's first element reaches the consumer without waiting for a full batch:
+    // the producer only makes the second element once the first one has been received.
+    std::atomic<bool> received{false};
+    bool timedOut = false;
+    std::vector<int> three{0, 1, 2};
+    auto source = jstream::of(three);
+    auto gated = source.map([&](int x) {
+        auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (x > 0 && !received && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(1ms);
+        timedOut |= x > 0 && !received;
+        return x;
+    });
+    int sum = 0;
+    gated.async(1024, 64).forEach([&](int x) {
+        received = true;
+        sum += x;
+    });
+    CHECK(sum == 3 && !timedOut);
+}
@@ -0,0 +1,56 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+int main()
+{
+    std::vector<long> v(1000000);
+    for (long i = 0; i < long(v.size()); i++)
+        v[i] = i;
+    long expectedSum = 0;
+    std::size_t expectedCount = 0;
+    for (long x : v)
+        if (x * 2 % 3 == 0)
+        {
+            expectedSum += x * 2;
+            expectedCount++;
+        }
+
+    // Upstream runs once; every replay reads the materialized elements.
+    int calls = 0;
+    auto cached = jstream::of(v)
+                      .map([&](long x) {
+                          calls++;
+                          return x * 2;
+                      })
+                      .filter([](long x) { return x % 3 == 0; })
+                      .cache();
+    CHECK(calls == 1000000 && !cached.spilled());
+    CHECK(cached.stream().count() == expectedCount);
+    CHECK(cached.stream().sum() == expectedSum);
+    CHECK(calls == 1000000);
+
+    // Past the memory budget trivially copyable elements move to a mapped file.
+    auto spilled = jstream::of(v).filter([](long x) { return x % 3 == 0; }).cache(1 << 16);
+    CHECK(spilled.spilled());
+    CHECK(spilled.stream().count() == (v.size() + 2) / 3);
+    long sum = 0;
+    spilled.stream().forEach([&](long x) { sum += x; });
+    CHECK(sum == spilled.stream().sum());
+    CHECK(spilled.stream().limit(3).sum() == 0 + 3 + 6);
+    auto moved = std::move(spilled);
+    CHECK(moved.stream().count() == (v.size() + 2) / 3);
+
+    // Other elements stay in memory whatever the budget.
+    std::list<std::string> words{"a", "bb", "ccc"};
+    auto strings = jstream::of(words).cache(0);
+    std::string joined;
+    strings.stream().forEach([&](std::string const &x) { joined += x; });
+    CHECK(joined == "abbccc" && !strings.spilled());
+
+    std::vector<int> empty;
+    CHECK(jstream::of(empty).cache(0).stream().count() == 0);
+}
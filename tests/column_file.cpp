@@ -0,0 +1,100 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Whether reading bytes as a column file with the given columns fails.
+template <typename... T>
+bool rejects(std::string const &bytes, std::tuple<T...>)
+{
+    std::stringstream file(bytes, std::ios::in | std::ios::binary);
+    try
+    {
+        jstream::readColumns<T...>(file).count();
+    }
+    catch (std::runtime_error const &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    using Row = std::tuple<long, int, double, std::uint8_t, std::int16_t>;
+    std::size_t n = 100000;
+    std::vector<Row> rows;
+    for (std::size_t i = 0; i < n; i++)
+        rows.emplace_back(long(i) * 3 + 1000000000000L, int(i % 7) - 3, double(i % 1000) / 8, std::uint8_t(i * 13),
+                          std::int16_t(i % 2 ? -int(i % 300) : int(i % 300)));
+    std::stringstream file(std::ios::in | std::ios::out | std::ios::binary);
+    jstream::of(rows).writeColumns(file, 4096);
+    std::string bytes = file.str();
+    CHECK(bytes.size() < n * (8 + 4 + 8 + 1 + 2));
+
+    {
+        std::stringstream in(bytes, std::ios::in | std::ios::binary);
+        std::size_t i = 0;
+        jstream::readColumns<long, int, double, std::uint8_t, std::int16_t>(in).forEach([&](auto const &row) {
+            CHECK(row.materialize() == rows[i]);
+            i++;
+        });
+        CHECK(i == n);
+    }
+
+    // Zone maps skip row groups that cannot match.
+    {
+        std::stringstream in(bytes, std::ios::in | std::ios::binary);
+        auto file = jstream::readColumns<long, int, double, std::uint8_t, std::int16_t>(in);
+        long lo = 1000000000000L + 3 * 50000, hi = 1000000000000L + 3 * 50999;
+        auto range = file.where<0>(jstream::between(lo, hi));
+        auto filtered = range.where<1>(jstream::atLeast(2));
+        std::size_t count = 0, expected = 0;
+        filtered.forEach([&](auto const &row) {
+            CHECK(row.template get<0>() >= lo && row.template get<0>() <= hi && row.template get<1>() >= 2);
+            count++;
+        });
+        for (Row const &r : rows)
+            expected += std::get<0>(r) >= lo && std::get<0>(r) <= hi && std::get<1>(r) >= 2;
+        CHECK(count == expected);
+        CHECK(file.skippedChunks() >= 20);
+    }
+
+    // Tuples of references, as zip() yields, write their value types.
+    std::vector<int> a{1, 2, 3}, b{-4, 5, -6};
+    std::stringstream zipped(std::ios::in | std::ios::out | std::ios::binary);
+    jstream::zip(jstream::of(a), jstream::of(b)).writeColumns(zipped);
+    std::vector<std::tuple<int, int>> pairs;
+    jstream::readColumns<int, int>(zipped).forEach([&](auto const &row) { pairs.push_back(row.materialize()); });
+    CHECK((pairs == std::vector<std::tuple<int, int>>{{1, -4}, {2, 5}, {3, -6}}));
+
+    // The destructor closes a writer left open.
+    std::stringstream open(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        jstream::ColumnFileWriter<float> writer(open);
+        writer.append(1.5f);
+        writer.append(-2.5f);
+    }
+    CHECK(jstream::readColumns<float>(open).map([](auto const &row) { return row.template get<0>(); }).sum() == -1.0f);
+
+    std::vector<std::tuple<float>> none;
+    std::stringstream empty(std::ios::in | std::ios::out | std::ios::binary);
+    jstream::of(none).writeColumns(empty);
+    CHECK(jstream::readColumns<float>(empty).count() == 0);
+
+    // Damaged files are rejected before their offsets are used.
+    CHECK(rejects(bytes, std::tuple<int>{}));
+    CHECK(rejects(bytes.substr(0, bytes.size() - 1), Row{}));
+    CHECK(rejects(bytes.substr(0, 20), Row{}));
+    std::string badFooter = bytes;
+    badFooter[badFooter.size() - 6] ^= 0x40;
+    CHECK(rejects(badFooter, Row{}));
+    std::string badMagic = bytes;
+    badMagic.back() = 'X';
+    CHECK(rejects(badMagic, Row{}));
+}
@@ -0,0 +1,61 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <array>
+#include <string>
+#include <tuple>
+#include <vector>
+
+int main()
+{
+    std::size_t n = 5000;
+    std::vector<int> id(n);
+    std::vector<double> price(n);
+    std::vector<std::string> name(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        id[i] = int(i);
+        price[i] = double(i * 37 % 100);
+        name[i] = std::to_string(i);
+    }
+
+    CHECK(jstream::columns(id, price, name).size() == n);
+    long total = 0;
+    jstream::columns(id, price, name).forEach([&](auto const &row) {
+        auto const &[a, b, c] = row;
+        total += a;
+        CHECK(c == std::to_string(a));
+        (void)b;
+    });
+    CHECK(total == long(n * (n - 1) / 2));
+
+    // where() on one column, then another, against a plain loop.
+    long expected = 0, expectedCount = 0;
+    for (std::size_t i = 0; i < n; i++)
+        if (price[i] > 90 && id[i] % 2 == 0)
+        {
+            expected += id[i];
+            expectedCount++;
+        }
+    long sum = 0, count = 0;
+    jstream::columns(id, price, name)
+        .where<1>([](double p) { return p > 90; })
+        .where<0>([](int i) { return i % 2 == 0; })
+        .forEach([&](auto const &row) {
+            sum += row.template get<0>();
+            count++;
+            CHECK(row.template get<2>() == std::to_string(row.index()));
+        });
+    CHECK(sum == expected);
+    CHECK(count == expectedCount);
+    CHECK(jstream::columns(id, price).where<1>([](double p) { return p > 1000; }).count() == 0);
+
+    auto row = jstream::columns(id, name).where<0>([](int i) { return i == 4321; }).findFirst()->materialize();
+    CHECK(std::get<0>(row) == 4321);
+    CHECK(std::get<1>(row) == "4321");
+
+    // The shortest column bounds the rows.
+    std::array<short, 3> small{1, 2, 3};
+    CHECK(jstream::columns(small, id).map([](auto const &r) { return r.template get<0>() * r.template get<1>(); }).sum() == 0 * 1 + 2 * 1 + 3 * 2);
+    CHECK(jstream::columns(id).parallel().anyMatch([](auto const &r) { return r.template get<0>() == 4999; }));
+}
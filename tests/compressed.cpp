@@ -0,0 +1,91 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+int main()
+{
+    std::mt19937 rng(7);
+    for (auto codec : {jstream::IntegerCodec::streamVByte, jstream::IntegerCodec::bitPacked})
+    {
+        for (std::size_t n : {0, 1, 127, 128, 129, 1000, 100000})
+        {
+            std::vector<std::uint32_t> ids(n), raw(n), zeros(n, 0);
+            std::uint32_t last = 0;
+            for (std::uint32_t &v : ids)
+                v = last += rng() % 300;
+            for (std::uint32_t &v : raw)
+                v = rng() >> (rng() % 32);
+            if (n)
+                raw[n / 2] = 0xffffffffu;
+
+            // Round trips with and without delta coding, sorted or not.
+            for (auto const *values : {&ids, &raw, &zeros})
+                for (bool delta : {false, true})
+                {
+                    auto list = jstream::of(*values).collect(jstream::compressing(codec, delta));
+                    CHECK(list.size() == n);
+                    CHECK(list.sorted() == std::is_sorted(values->begin(), values->end()));
+                    std::vector<std::uint32_t> decoded;
+                    jstream::of(list).forEach([&](std::uint32_t v) { decoded.push_back(v); });
+                    CHECK(decoded == *values);
+                }
+
+            auto sorted = jstream::of(ids).collect(jstream::compressing(codec, true));
+            if (n == 100000)
+                CHECK(sorted.bytes() < n * sizeof(std::uint32_t) / 2);
+
+            // skipTo against lower_bound, from part way in and in succession.
+            for (int q = 0; q < 200 && n; q++)
+            {
+                std::uint32_t key = rng() % (last + 500);
+                std::size_t skipped = rng() % (n / 2 + 1);
+                auto s = jstream::of(sorted);
+                for (std::size_t i = 0; i < skipped; i++)
+                    s.next();
+                s.skipTo(key);
+                auto it = std::lower_bound(ids.begin() + skipped, ids.end(), key);
+                if (it == ids.end())
+                    CHECK(s.empty());
+                else
+                    CHECK(!s.empty() && *s.next() == *it);
+
+                auto twice = jstream::of(sorted);
+                twice.skipTo(key / 2);
+                twice.skipTo(key);
+                it = std::lower_bound(ids.begin(), ids.end(), key);
+                if (it == ids.end())
+                    CHECK(twice.empty());
+                else
+                    CHECK(*twice.next() == *it);
+            }
+        }
+    }
+
+    // Negative signed keys are before every element.
+    std::vector<std::uint32_t> few{3, 70000};
+    auto compressedFew = jstream::of(few).collect(jstream::compressing(jstream::IntegerCodec::bitPacked, true));
+    auto fs = jstream::of(compressedFew);
+    fs.skipTo(-5);
+    CHECK(*fs.next() == 3);
+    fs.skipTo(5000000000LL);
+    CHECK(fs.empty());
+
+    // Compressed lists feed the sorted set operations.
+    std::vector<std::uint32_t> p, q, expected;
+    for (std::uint32_t i = 0; i < 200000; i += 3)
+        p.push_back(i);
+    for (std::uint32_t i = 0; i < 200000; i += 1000)
+        q.push_back(i);
+    std::set_intersection(p.begin(), p.end(), q.begin(), q.end(), std::back_inserter(expected));
+    auto cp = jstream::of(p).collect(jstream::compressing(jstream::IntegerCodec::streamVByte, true));
+    auto cq = jstream::of(q).collect(jstream::compressing(jstream::IntegerCodec::bitPacked, true));
+    auto sp = jstream::of(cp);
+    auto sq = jstream::of(cq);
+    std::vector<std::uint32_t> got;
+    jstream::intersectSorted(sp, sq).forEach([&](std::uint32_t v) { got.push_back(v); });
+    CHECK(got == expected);
+}
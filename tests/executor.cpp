@@ -0,0 +1,79 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+int main()
+{
+    jstream::Executor ex(3, true);
+    std::atomic<long> total{0};
+    ex.parallelFor(1000, [&](std::size_t i) { total += long(i); });
+    CHECK(total == 999 * 1000 / 2);
+
+    std::atomic<long> nested{0};
+    ex.parallelFor(20, [&](std::size_t) { ex.parallelFor(50, [&](std::size_t j) { nested += long(j); }); });
+    CHECK(nested == 20 * (49 * 50 / 2));
+
+    bool threw = false;
+    try
+    {
+        ex.parallelFor(10, [](std::size_t i) {
+            if (i == 7)
+                throw std::runtime_error("boom");
+        });
+    }
+    catch (std::runtime_error const &)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // An external thread blocks until the last task finishes.
+    std::atomic<int> done{0};
+    for (int i = 0; i < 5000; i++)
+        ex.submit([&] { done++; });
+    ex.waitUntil([&] { return done == 5000; });
+    CHECK(done == 5000);
+
+    // ...and wakes up on notify() when progress comes from outside the pool.
+    std::atomic<bool> flag{false};
+    std::thread signaller([&] {
+        std::this_thread::sleep_for(20ms);
+        flag = true;
+        ex.notify();
+    });
+    ex.waitUntil([&] { return flag.load(); });
+    signaller.join();
+
+    // Nested parallel pipelines on a custom executor.
+    std::vector<int> outer(40);
+    std::iota(outer.begin(), outer.end(), 0);
+    std::vector<long> sums;
+    auto src = jstream::of(outer);
+    src.parallelMap(
+           [&](int n) {
+               std::vector<int> in(n);
+               std::iota(in.begin(), in.end(), 0);
+               long s = 0;
+               auto inner = jstream::of(in);
+               inner.parallelMap([](int x) { return long(x); }, 0, 8, ex).forEach([&](long x) { s += x; });
+               return s;
+           },
+           0, 0, ex)
+        .forEach([&](long s) { sums.push_back(s); });
+    CHECK(sums.size() == outer.size());
+    for (int n = 0; n < 40; n++)
+        CHECK(sums[n] == long(n) * (n - 1) / 2);
+
+    jstream::Executor single(1);
+    std::atomic<long> count{0};
+    single.parallelFor(100, [&](std::size_t) { single.parallelFor(10, [&](std::size_t) { count++; }); });
+    CHECK(count == 1000);
+}
@@ -0,0 +1,53 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+int main()
+{
+    std::vector<int> v(1 << 20);
+    std::iota(v.begin(), v.end(), 0);
+
+    int calls = 0;
+    CHECK(!jstream::of(v).allMatch([&](int x) { calls++; return x < 10; }) && calls == 11);
+    calls = 0;
+    CHECK(!jstream::of(v).noneMatch([&](int x) { calls++; return x == 5; }) && calls == 6);
+    CHECK(jstream::of(v).allMatch([](int x) { return x >= 0; }));
+    CHECK(*jstream::of(v).findFirst() == 0);
+    CHECK(*jstream::of(v).filter([](int x) { return x > 100; }).findAny() == 101);
+    CHECK(*jstream::of(v).findFirst([](int x) { return x % 1000 == 999; }) == 999);
+    CHECK(!jstream::of(v).findFirst([](int x) { return x < 0; }));
+
+    jstream::Executor ex(4);
+    for (int rep = 0; rep < 20; rep++)
+    {
+        CHECK(*jstream::of(v).parallel(ex).findFirst([](int x) { return x % 100000 == 99999; }) == 99999);
+        auto any = jstream::of(v).parallel(ex).findAny([](int x) { return x % 100000 == 99999; });
+        CHECK(any && *any % 100000 == 99999);
+        CHECK(jstream::of(v).parallel(ex).anyMatch([](int x) { return x == 777777; }));
+        CHECK(!jstream::of(v).parallel(ex).anyMatch([](int x) { return x < 0; }));
+        CHECK(jstream::of(v).parallel(ex).allMatch([](int x) { return x >= 0; }));
+        CHECK(!jstream::of(v).parallel(ex).allMatch([](int x) { return x < 500000; }));
+        CHECK(jstream::of(v).parallel(ex).noneMatch([](int x) { return x > (1 << 20); }));
+        CHECK(!jstream::of(v).parallel(ex).findFirst([](int x) { return x < 0; }));
+    }
+
+    // map() over a parallel stream stays parallel.
+    auto src = jstream::of(v);
+    auto bound = src.parallel(ex);
+    auto doubled = bound.map([](int x) { return x * 2; });
+    static_assert(jstream::ParallelStream<decltype(doubled)>);
+    CHECK(&doubled.executor() == &ex);
+    CHECK(*doubled.findFirst([](int x) { return x > 1000000; }) == 1000002);
+
+    std::atomic<long> evaluated{0};
+    CHECK(jstream::of(v).parallel(ex).anyMatch([&](int x) { evaluated++; return x == 3; }));
+    CHECK(evaluated < long(v.size()));
+    CHECK(jstream::of(v).parallel().findFirst().value() == 0);
+    CHECK(jstream::of(v).parallel(ex).count() == v.size());
+
+    std::vector<int> none;
+    CHECK(!jstream::of(none).parallel(ex).findFirst([](int) { return true; }));
+}
@@ -0,0 +1,104 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <functional>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Event
+{
+    int time;
+    int value;
+};
+
+template <typename S>
+std::vector<std::pair<int, std::size_t>> collect(S &&s)
+{
+    std::vector<std::pair<int, std::size_t>> out;
+    s.forEach([&](auto const &group) { out.emplace_back(group.first, group.second); });
+    return out;
+}
+
+int main()
+{
+    // Sorted input alone does not switch groupBy to per-run grouping.
+    std::vector<int> v{1, 2, 3, 4, 5, 6};
+    auto source = jstream::of(v);
+    auto sorted = source.sort();
+    auto parity = sorted.groupBy([](int x) { return x % 2; }, jstream::count());
+    std::map<int, std::size_t> counts;
+    parity.forEach([&](auto const &group) { counts[group.first] = group.second; });
+    CHECK((counts == std::map<int, std::size_t>{{0, 3}, {1, 3}}));
+
+    // Both paths yield the same pairs.
+    auto key = [](int x) { return x / 2; };
+    using hashed = decltype(source.groupBy(key, jstream::count()));
+    using adjacent = decltype(source.groupBy(key, jstream::count(), jstream::monotonic));
+    static_assert(std::is_same_v<hashed::value_type, adjacent::value_type>);
+    static_assert(std::is_same_v<adjacent, decltype(source.groupAdjacentBy(key, jstream::count()))>);
+    static_assert(!jstream::SortedStream<adjacent>);
+
+    // Grouping a sorted stream by std::identity streams per run and stays sorted.
+    std::vector<int> w{5, 1, 5, 2, 1, 5};
+    auto unsorted = jstream::of(w);
+    auto ascending = unsorted.sort();
+    auto runs = ascending.groupBy(std::identity{}, jstream::count());
+    static_assert(jstream::SortedStream<decltype(runs)>);
+    static_assert(std::is_same_v<decltype(runs), decltype(ascending.groupAdjacentBy(std::identity{}, jstream::count()))>);
+    CHECK((collect(runs) == std::vector<std::pair<int, std::size_t>>{{1, 2}, {2, 1}, {5, 3}}));
+
+    // Time-ordered events grouped by a monotone bucket of the time.
+    std::vector<Event> events{{1, 1}, {1, 2}, {2, 5}, {3, 1}, {3, 1}, {7, 4}};
+    std::vector<std::pair<int, int>> sums;
+    jstream::of(events)
+        .map([](Event const &e) { return e.value; })
+        .groupAdjacentBy([&](int) { return 0; }, jstream::sum())
+        .forEach([&](auto const &group) { sums.emplace_back(group.first, group.second); });
+    CHECK((sums == std::vector<std::pair<int, int>>{{0, 14}}));
+    CHECK((collect(jstream::of(events).groupBy([](Event const &e) { return e.time / 2; }, jstream::count(), jstream::monotonic)) ==
+           std::vector<std::pair<int, std::size_t>>{{0, 2}, {1, 3}, {3, 1}}));
+
+    // Random runs against a reference, with string keys to exercise the emitted key's lifetime.
+    std::mt19937 rng(32);
+    for (std::size_t n : {0, 1, 2, 100, 5000})
+    {
+        std::vector<int> x(n);
+        for (auto &e : x)
+            e = int(rng() % 4);
+        std::list<int> l(x.begin(), x.end());
+        std::vector<std::pair<std::string, std::size_t>> expected, got;
+        for (std::size_t i = 0; i < n; i++)
+            if (i > 0 && x[i] == x[i - 1])
+                expected.back().second++;
+            else
+                expected.emplace_back(std::to_string(x[i]), 1);
+        jstream::of(l).groupAdjacentBy([](int e) { return std::to_string(e); }, jstream::count()).forEach([&](auto const &group) {
+            got.emplace_back(group.first, group.second);
+        });
+        CHECK(got == expected);
+
+        std::map<int, int> reference, hashed;
+        for (int e : x)
+            reference[e] += e + 1;
+        jstream::of(l).map([](int e) { return e + 1; }).groupBy([](int e) { return e - 1; }, jstream::sum()).forEach([&](auto const &group) {
+            hashed[group.first] = group.second;
+        });
+        CHECK(hashed == reference);
+
+        std::vector<std::vector<int>> chunks, chunked;
+        for (std::size_t i = 0; i < n; i++)
+            if (i > 0 && x[i] >= x[i - 1])
+                chunks.back().push_back(x[i]);
+            else
+                chunks.push_back({x[i]});
+        auto nondecreasing = [](int a, int b) { return a <= b; };
+        jstream::of(x).chunkBy(nondecreasing).forEach([&](auto chunk) { chunked.emplace_back(chunk.begin(), chunk.end()); });
+        CHECK(chunked == chunks);
+        chunked.clear();
+        jstream::of(l).chunkBy(nondecreasing).forEach([&](auto chunk) { chunked.emplace_back(chunk.begin(), chunk.end()); });
+        CHECK(chunked == chunks);
+    }
+}
@@ -0,0 +1,109 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Order
+{
+    int id;
+    int customer;
+};
+
+struct Customer
+{
+    int id;
+    std::string name;
+};
+
+using Rows = std::multiset<std::pair<int, std::string>>;
+
+template <typename Kind>
+Rows reference(std::vector<Order> const &orders, std::vector<Customer> const &customers, Kind)
+{
+    std::multimap<int, std::string> byId;
+    for (auto const &c : customers)
+        byId.emplace(c.id, c.name);
+    Rows rows;
+    for (auto const &o : orders)
+    {
+        auto [begin, end] = byId.equal_range(o.customer);
+        if constexpr (Kind::value == jstream::JoinKind::inner || Kind::value == jstream::JoinKind::left)
+            for (auto it = begin; it != end; ++it)
+                rows.emplace(o.id, it->second);
+        if constexpr (Kind::value == jstream::JoinKind::left)
+            if (begin == end)
+                rows.emplace(o.id, "-");
+        if constexpr (Kind::value == jstream::JoinKind::semi || Kind::value == jstream::JoinKind::anti)
+            if ((begin != end) == (Kind::value == jstream::JoinKind::semi))
+                rows.emplace(o.id, "");
+    }
+    return rows;
+}
+
+template <typename S, typename Kind>
+Rows join(S &&orders, std::vector<Customer> const &customers, Kind kind)
+{
+    Rows rows;
+    auto right = jstream::of(customers);
+    orders.hashJoin(right, [](Order const &o) { return o.customer; }, [](Customer const &c) { return c.id; }, kind).forEach([&](auto const &r) {
+        if constexpr (Kind::value == jstream::JoinKind::inner)
+            rows.emplace(r.first.id, r.second.name);
+        else if constexpr (Kind::value == jstream::JoinKind::left)
+            rows.emplace(r.first.id, r.second ? r.second->name : "-");
+        else
+            rows.emplace(r.id, "");
+    });
+    return rows;
+}
+
+template <typename Kind>
+void check(std::vector<Order> const &orders, std::vector<Customer> const &customers, Kind kind)
+{
+    Rows expected = reference(orders, customers, kind);
+    CHECK(join(jstream::of(orders), customers, kind) == expected);
+    std::list<Order> sequential(orders.begin(), orders.end());
+    CHECK(join(jstream::of(sequential), customers, kind) == expected);
+}
+
+int main()
+{
+    std::mt19937 rng(31);
+    // The largest size makes the build side exceed cacheBytes, which takes the partitioned path.
+    for (int n : {0, 10, 1000, 60000})
+    {
+        std::vector<Order> orders;
+        std::vector<Customer> customers;
+        for (int i = 0; i < n; i++)
+            orders.push_back({i, int(rng() % unsigned(n + 10))});
+        for (int i = 0; i < n / 2 + 1; i++)
+            customers.push_back({int(rng() % unsigned(n + 10)), std::to_string(i)});
+        check(orders, customers, jstream::innerJoin);
+        check(orders, customers, jstream::leftJoin);
+        check(orders, customers, jstream::semiJoin);
+        check(orders, customers, jstream::antiJoin);
+        std::vector<Order> few(orders.begin(), orders.begin() + std::min(n, 5));
+        check(few, customers, jstream::innerJoin);
+    }
+
+    // A partitioned join still streams its probe side: the first match arrives after at most
+    // one batch has been read.
+    std::vector<Customer> customers;
+    for (int i = 0; i < 100000; i++)
+        customers.push_back({i, std::to_string(i)});
+    std::list<Order> orders;
+    for (int i = 0; i < 300000; i++)
+        orders.push_back({i, i % 100000});
+    std::size_t pulled = 0;
+    auto source = jstream::of(orders);
+    auto probe = source.peek([&](Order const &) { pulled++; });
+    auto right = jstream::of(customers);
+    auto joined = probe.hashJoin(right, [](Order const &o) { return o.customer; }, [](Customer const &c) { return c.id; }, jstream::leftJoin);
+    CHECK(!joined.empty());
+    CHECK(pulled < orders.size() / 2);
+    CHECK(joined.count() == orders.size());
+}
@@ -0,0 +1,64 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <random>
+#include <vector>
+
+template <typename S>
+std::vector<int> collect(S &&s)
+{
+    std::vector<int> out;
+    s.forEach([&](int x) { out.push_back(x); });
+    return out;
+}
+
+int main()
+{
+    std::vector<int> a{1, 4, 7, 10}, b{2, 5, 8}, c{};
+    std::list<int> d{0, 3, 3, 11};
+    CHECK((collect(jstream::mergeSorted(jstream::of(a), jstream::of(b), jstream::of(c), jstream::of(d))) == std::vector<int>{0, 1, 2, 3, 3, 4, 5, 7, 8, 10, 11}));
+    CHECK(jstream::mergeSorted(jstream::of(a), jstream::of(b)).limit(3).sum() == 7);
+
+    // Only ascending merges are marked sorted.
+    std::vector<int> ra{10, 7, 4, 1}, rb{8, 5, 2};
+    auto sa = jstream::of(ra), sb = jstream::of(rb);
+    auto descending = jstream::mergeSorted(sa, sb, std::greater<>{});
+    static_assert(!jstream::SortedStream<decltype(descending)>);
+    static_assert(jstream::SortedStream<decltype(jstream::mergeSorted(jstream::of(a), jstream::of(b)))>);
+    static_assert(jstream::SortedStream<decltype(jstream::mergeSorted(jstream::of(a), jstream::of(b)).filter([](int) { return true; }))>);
+    CHECK((collect(descending) == std::vector<int>{10, 8, 7, 5, 4, 2, 1}));
+
+    std::mt19937 rng(29);
+    for (int k : {1, 2, 3, 5, 17, 64})
+    {
+        std::vector<std::vector<int>> runs(k);
+        std::vector<int> all;
+        for (auto &run : runs)
+        {
+            for (int n = int(rng() % 50); n > 0; n--)
+                run.push_back(int(rng() % 1000));
+            std::sort(run.begin(), run.end());
+            all.insert(all.end(), run.begin(), run.end());
+        }
+        std::sort(all.begin(), all.end());
+        std::vector<decltype(jstream::of(runs[0]))> streams;
+        for (auto &run : runs)
+            streams.push_back(jstream::of(run));
+        static_assert(jstream::SortedStream<decltype(jstream::mergeSorted(streams))>);
+        CHECK(collect(jstream::mergeSorted(streams)) == all);
+
+        for (auto &run : runs)
+            std::reverse(run.begin(), run.end());
+        std::reverse(all.begin(), all.end());
+        std::vector<decltype(jstream::of(runs[0]))> reversed;
+        for (auto &run : runs)
+            reversed.push_back(jstream::of(run));
+        static_assert(!jstream::SortedStream<decltype(jstream::mergeSorted(reversed, std::greater<>{}))>);
+        CHECK(collect(jstream::mergeSorted(reversed, std::greater<>{})) == all);
+    }
+    std::vector<decltype(jstream::of(a))> none;
+    CHECK(jstream::mergeSorted(none).count() == 0);
+}
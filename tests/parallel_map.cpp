@@ -0,0 +1,88 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main()
+{
+    jstream::Executor executor(4);
+    std::vector<long> v(20000);
+    for (long i = 0; i < long(v.size()); i++)
+        v[i] = i;
+
+    std::vector<long> ordered;
+    jstream::of(v).parallelMap([](long x) { return x * 2; }, 4, 16, executor).forEach([&](long x) { ordered.push_back(x); });
+    CHECK(ordered.size() == v.size());
+    for (std::size_t i = 0; i < ordered.size(); i++)
+        CHECK(ordered[i] == 2 * long(i));
+
+    std::multiset<long> unordered;
+    jstream::of(v).parallelMap([](long x) { return x * 2; }, 4, 16, executor).unordered().forEach([&](long x) { unordered.insert(x); });
+    CHECK(unordered.size() == v.size() && *unordered.begin() == 0 && *unordered.rbegin() == 2 * 19999);
+
+    // At most `window` elements are in flight at once.
+    std::atomic<int> inFlight{0}, peak{0};
+    jstream::of(v)
+        .parallelMap(
+            [&](long x) {
+                int now = ++inFlight;
+                for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);)
+                    ;
+                --inFlight;
+                return x;
+            },
+            4, 8, executor)
+        .count();
+    CHECK(peak <= 8);
+
+    // Sequential upstreams, the global executor and early termination.
+    std::vector<std::vector<int>> nested{{1, 2}, {3}, {}, {4, 5, 6}};
+    std::vector<std::string> strings;
+    jstream::of(nested)
+        .flatMap([](std::vector<int> const &x) { return jstream::of(x); })
+        .parallelMap([](int x) { return std::to_string(x); }, 3)
+        .forEach([&](std::string const &x) { strings.push_back(x); });
+    CHECK((strings == std::vector<std::string>{"1", "2", "3", "4", "5", "6"}));
+    CHECK(jstream::of(v).parallelMap([](long x) { return x; }).limit(5).sum() == 10);
+    std::vector<int> empty;
+    CHECK(jstream::of(empty).parallelMap([](int x) { return x; }).count() == 0);
+
+    // Errors are rethrown in encounter order and the stage stays usable afterwards, also when
+    // the failed slot is the next one reused.
+    long expected = 0;
+    for (long x : v)
+        if (x % 1000 != 77)
+            expected += x;
+    for (std::size_t window : {1, 16})
+    {
+        auto source = jstream::of(v);
+        auto failing = source.parallelMap(
+            [](long x) {
+                if (x % 1000 == 77)
+                    throw std::runtime_error("bad element");
+                return x;
+            },
+            4, window, executor);
+        std::size_t errors = 0, values = 0;
+        long sum = 0;
+        while (true)
+        {
+            try
+            {
+                if (failing.empty())
+                    break;
+                sum += *failing.next();
+                values++;
+            }
+            catch (std::runtime_error const &)
+            {
+                errors++;
+            }
+        }
+        CHECK(errors == 20 && values == v.size() - 20 && sum == expected);
+    }
+}
@@ -0,0 +1,112 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+int main()
+{
+    std::mt19937 rng(3);
+    auto make = [&](int kind) {
+        std::set<std::uint32_t> s;
+        if (kind == 0) // sparse arrays
+            for (int i = 0; i < 3000; i++)
+                s.insert(rng() % 200000);
+        if (kind == 1) // dense bitmaps
+            for (int i = 0; i < 60000; i++)
+                s.insert(rng() % 131072);
+        if (kind == 2) // runs
+            for (std::uint32_t i = 70000; i < 140000; i++)
+                s.insert(i);
+        if (kind == 3) // spread over the whole range
+            for (int i = 0; i < 1000; i++)
+                s.insert(rng());
+        return s;
+    };
+    auto toVector = [](jstream::RoaringBitmap const &bitmap) {
+        std::vector<std::uint32_t> v;
+        jstream::of(bitmap).forEach([&](std::uint32_t x) { v.push_back(x); });
+        return v;
+    };
+
+    for (int ka = 0; ka < 4; ka++)
+        for (int kb = 0; kb < 4; kb++)
+            for (bool optimize : {false, true})
+            {
+                std::set<std::uint32_t> sa = make(ka), sb = make(kb);
+                std::vector<std::uint32_t> va(sa.begin(), sa.end()), vb(sb.begin(), sb.end());
+                std::shuffle(va.begin(), va.end(), rng);
+                auto a = jstream::of(va).collectToBitmap();
+                auto b = jstream::of(vb).collectToBitmap();
+                if (optimize)
+                {
+                    a.optimize();
+                    b.optimize();
+                }
+                CHECK(a.cardinality() == sa.size());
+                CHECK(toVector(a) == std::vector<std::uint32_t>(sa.begin(), sa.end()));
+
+                std::vector<std::uint32_t> i, u, d;
+                std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(i));
+                std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(u));
+                std::set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(d));
+                CHECK(toVector(a & b) == i);
+                CHECK(toVector(a | b) == u);
+                CHECK(toVector(jstream::andNot(a, b)) == d);
+
+                for (int q = 0; q < 300; q++)
+                {
+                    std::uint32_t x = q % 2 ? rng() % 300000 : rng();
+                    CHECK(a.contains(x) == (sa.count(x) == 1));
+                    auto s = jstream::of(a);
+                    s.skipTo(x);
+                    auto it = sa.lower_bound(x);
+                    if (it == sa.end())
+                        CHECK(s.empty());
+                    else
+                        CHECK(*s.next() == *it);
+                }
+                auto sa2 = jstream::of(a);
+                auto sb2 = jstream::of(b);
+                CHECK(jstream::intersectSorted(sa2, sb2).count() == i.size());
+            }
+
+    // Run containers shrink long runs.
+    auto runs = make(2);
+    std::vector<std::uint32_t> rv(runs.begin(), runs.end());
+    auto rb = jstream::of(rv).collectToBitmap();
+    std::size_t before = rb.bytes();
+    rb.optimize();
+    CHECK(rb.bytes() < before / 100);
+    CHECK(toVector(rb) == rv);
+
+    // Negative signed keys are before every element.
+    std::vector<std::uint32_t> few{3, 70000};
+    auto fb = jstream::of(few).collectToBitmap();
+    auto fs = jstream::of(fb);
+    fs.skipTo(-5);
+    CHECK(*fs.next() == 3);
+    fs.skipTo(5000000000LL);
+    CHECK(fs.empty());
+
+    std::vector<int> small{5, -3, 5, 7, -3, 100000, 0};
+    CHECK(jstream::of(small).countDistinct() == 5);
+    std::vector<double> dd{1.5, 2.5, 1.5};
+    CHECK(jstream::of(dd).countDistinct() == 2);
+    auto [count, bitmap] = jstream::of(small).aggregate(jstream::countDistinct(), jstream::toBitmap());
+    CHECK(count == 5 && bitmap.cardinality() == 5 && bitmap.contains(std::uint32_t(-3)));
+
+    // distinct() on small integers keeps first occurrences in order.
+    std::vector<int> firsts;
+    jstream::of(small).distinct().forEach([&](int x) { firsts.push_back(x); });
+    CHECK((firsts == std::vector<int>{5, -3, 7, 100000, 0}));
+    std::vector<std::uint16_t> shorts(100000);
+    for (std::size_t k = 0; k < shorts.size(); k++)
+        shorts[k] = std::uint16_t(k * 7 % 1000);
+    CHECK(jstream::of(shorts).distinct().count() == 1000);
+    CHECK(jstream::of(shorts).distinct(1024).count() == 1000);
+}
@@ -0,0 +1,59 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <vector>
+
+template <typename S>
+std::vector<int> collect(S &&s)
+{
+    std::vector<int> out;
+    s.forEach([&](int x) { out.push_back(x); });
+    return out;
+}
+
+int main()
+{
+    std::vector<int> v(100000);
+    for (int i = 0; i < int(v.size()); i++)
+        v[i] = i;
+    std::list<int> l(v.begin(), v.end());
+
+    // Reservoir samples are reproducible per seed and independent of the source's access pattern.
+    auto reservoir = collect(jstream::of(v).sample(100, 42));
+    CHECK(reservoir.size() == 100);
+    CHECK(reservoir == collect(jstream::of(l).sample(100, 42)));
+    CHECK(reservoir == collect(jstream::of(v).sample(100, 42)));
+    CHECK(jstream::of(v).limit(5).sample(10).count() == 5);
+    std::vector<int> sortedSample = reservoir;
+    std::sort(sortedSample.begin(), sortedSample.end());
+    CHECK(std::adjacent_find(sortedSample.begin(), sortedSample.end()) == sortedSample.end());
+
+    // Every element lands in a sample of 3 out of 10 with probability 0.3.
+    std::vector<int> hits(10);
+    std::vector<int> ten{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    for (int seed = 0; seed < 20000; seed++)
+        jstream::of(ten).sample(3, std::uint64_t(seed)).forEach([&](int x) { hits[x]++; });
+    for (int h : hits)
+        CHECK(std::abs(h / 20000.0 - 0.3) < 0.02);
+
+    // Bernoulli sampling skips geometrically, pulling upstream values only for kept elements
+    // over random access inputs, and keeps encounter order.
+    int reads = 0;
+    auto kept = jstream::of(v)
+                    .map([&](int x) {
+                        reads++;
+                        return x;
+                    })
+                    .sampleFraction(0.01, 7)
+                    .count();
+    CHECK(kept > 800 && kept < 1200);
+    CHECK(reads == int(kept));
+    auto fraction = collect(jstream::of(v).sampleFraction(0.01, 7));
+    CHECK(fraction == collect(jstream::of(l).sampleFraction(0.01, 7)));
+    CHECK(std::is_sorted(fraction.begin(), fraction.end()));
+    CHECK(jstream::of(v).sampleFraction(1).count() == v.size());
+    CHECK(jstream::of(v).sampleFraction(0).count() == 0);
+}
@@ -0,0 +1,65 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <list>
+#include <numeric>
+#include <string>
+#include <vector>
+
+int main()
+{
+    jstream::Executor ex(3);
+    for (std::size_t n : {0, 1, 7, 8, 9, 255, 256, 257, 1000, 100003})
+    {
+        std::vector<int> v(n);
+        for (std::size_t i = 0; i < n; i++)
+            v[i] = int(i * 7919 % 1000) - 500;
+        std::vector<long> inclusive(n), exclusive(n);
+        std::inclusive_scan(v.begin(), v.end(), inclusive.begin(), std::plus<>{}, 10L);
+        std::exclusive_scan(v.begin(), v.end(), exclusive.begin(), 10L);
+
+        // Blocked (contiguous arithmetic) path.
+        std::vector<long> a, b;
+        jstream::of(v).scan(std::plus<>{}, 10L).forEach([&](long x) { a.push_back(x); });
+        jstream::of(v).exclusiveScan(std::plus<>{}, 10L).forEach([&](long x) { b.push_back(x); });
+        CHECK(a == inclusive);
+        CHECK(b == exclusive);
+
+        // Parallel paths, contiguous and through map().
+        std::vector<long> c, d, e;
+        jstream::of(v).parallel(ex).inclusiveScan(std::plus<>{}, 10L).forEach([&](long x) { c.push_back(x); });
+        jstream::of(v).parallel(ex).exclusiveScan(std::plus<>{}, 10L).forEach([&](long x) { d.push_back(x); });
+        jstream::of(v).map([](int x) { return x; }).parallel(ex).scan(std::plus<>{}, 10L).forEach([&](long x) { e.push_back(x); });
+        CHECK(c == inclusive);
+        CHECK(d == exclusive);
+        CHECK(e == inclusive);
+
+        // Element-at-a-time path.
+        std::list<int> l(v.begin(), v.end());
+        std::vector<long> f;
+        jstream::of(l).exclusiveScan(std::plus<>{}, 10L).forEach([&](long x) { f.push_back(x); });
+        CHECK(f == exclusive);
+
+        std::vector<int> maxima;
+        jstream::of(v).scan([](int x, int y) { return std::max(x, y); }, -1000).forEach([&](int x) { maxima.push_back(x); });
+        int m = -1000;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            m = std::max(m, v[i]);
+            CHECK(maxima[i] == m);
+        }
+    }
+
+    // Non-commutative operation on a non-arithmetic type.
+    std::vector<std::string> words{"a", "b", "c"}, joined;
+    auto concat = [](std::string acc, std::string const &s) { return acc + s; };
+    jstream::of(words).scan(concat, std::string(">")).forEach([&](std::string const &s) { joined.push_back(s); });
+    CHECK((joined == std::vector<std::string>{">a", ">ab", ">abc"}));
+    joined.clear();
+    jstream::of(words).parallel(ex).scan(concat, std::string(">")).forEach([&](std::string const &s) { joined.push_back(s); });
+    CHECK((joined == std::vector<std::string>{">a", ">ab", ">abc"}));
+
+    std::vector<int> ones(1000, 1);
+    CHECK(jstream::of(ones).scan(std::plus<>{}, 0).limit(3).sum() == 6);
+}
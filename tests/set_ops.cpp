@@ -0,0 +1,83 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <random>
+#include <vector>
+
+template <typename S>
+std::vector<int> collect(S &&s)
+{
+    std::vector<int> out;
+    s.forEach([&](int x) { out.push_back(x); });
+    return out;
+}
+
+int main()
+{
+    std::mt19937 rng(30);
+    for (int round = 0; round < 200; round++)
+    {
+        std::vector<int> a(rng() % 30), b(rng() % 300);
+        for (auto &x : a)
+            x = int(rng() % 100);
+        for (auto &x : b)
+            x = int(rng() % 100);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        std::list<int> lb(b.begin(), b.end());
+
+        std::vector<int> both, either, onlyA, onlyB;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(both));
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(either));
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(onlyA));
+        std::set_difference(b.begin(), b.end(), a.begin(), a.end(), std::back_inserter(onlyB));
+
+        // Random-access inputs gallop, sequential ones step.
+        CHECK(collect(jstream::intersectSorted(jstream::of(a), jstream::of(b))) == both);
+        CHECK(collect(jstream::intersectSorted(jstream::of(a), jstream::of(lb))) == both);
+        CHECK(collect(jstream::unionSorted(jstream::of(a), jstream::of(lb))) == either);
+        CHECK(collect(jstream::unionSorted(jstream::of(a), jstream::of(b))) == either);
+        CHECK(collect(jstream::differenceSorted(jstream::of(a), jstream::of(b))) == onlyA);
+        CHECK(collect(jstream::differenceSorted(jstream::of(lb), jstream::of(a).filter([](int) { return true; }))) == onlyB);
+
+        // Descending inputs under std::greater<> are not marked sorted.
+        std::vector<int> ra(a.rbegin(), a.rend()), rb(b.rbegin(), b.rend());
+        std::reverse(both.begin(), both.end());
+        std::reverse(either.begin(), either.end());
+        std::reverse(onlyA.begin(), onlyA.end());
+        CHECK(collect(jstream::intersectSorted(jstream::of(ra), jstream::of(rb), std::greater<>{})) == both);
+        CHECK(collect(jstream::unionSorted(jstream::of(ra), jstream::of(rb), std::greater<>{})) == either);
+        CHECK(collect(jstream::differenceSorted(jstream::of(ra), jstream::of(rb), std::greater<>{})) == onlyA);
+    }
+
+    std::vector<int> a{1, 2}, b{2, 3};
+    auto sa = jstream::of(a), sb = jstream::of(b);
+    static_assert(jstream::SortedStream<decltype(jstream::intersectSorted(sa, sb))>);
+    static_assert(jstream::SortedStream<decltype(jstream::unionSorted(sa, sb))>);
+    static_assert(jstream::SortedStream<decltype(jstream::differenceSorted(sa, sb))>);
+    static_assert(!jstream::SortedStream<decltype(jstream::intersectSorted(sa, sb, std::greater<>{}))>);
+    static_assert(!jstream::SortedStream<decltype(jstream::unionSorted(sa, sb, std::greater<>{}))>);
+    static_assert(!jstream::SortedStream<decltype(jstream::differenceSorted(sa, sb, std::greater<>{}))>);
+
+    // A short input against a long random-access one costs about |short| * log|long| comparisons.
+    std::vector<long> big(1 << 20);
+    for (std::size_t i = 0; i < big.size(); i++)
+        big[i] = 2 * long(i);
+    std::vector<long> small(100);
+    for (auto &x : small)
+        x = long(rng() % (4 << 20));
+    std::sort(small.begin(), small.end());
+    std::vector<long> expected;
+    std::set_intersection(small.begin(), small.end(), big.begin(), big.end(), std::back_inserter(expected));
+    long comparisons = 0;
+    auto cmp = [&](long x, long y) {
+        comparisons++;
+        return x < y;
+    };
+    CHECK(jstream::intersectSorted(jstream::of(small), jstream::of(big), cmp).count() == expected.size());
+    CHECK(comparisons < 100 * 4 * 22);
+}
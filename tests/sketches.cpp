@@ -0,0 +1,99 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+double rankOf(std::vector<double> const &sorted, double x)
+{
+    return double(std::lower_bound(sorted.begin(), sorted.end(), x) - sorted.begin()) / double(sorted.size());
+}
+
+int main()
+{
+    std::mt19937_64 rng(35);
+
+    // HyperLogLog at precision 14 stays within a few percent, merges and round-trips.
+    for (std::size_t n : {0, 10, 1000, 200000})
+    {
+        std::vector<std::uint64_t> v(n);
+        for (auto &x : v)
+            x = rng() % (n + 1);
+        std::vector<std::uint64_t> u = v;
+        std::sort(u.begin(), u.end());
+        u.erase(std::unique(u.begin(), u.end()), u.end());
+        double distinct = double(u.size());
+        auto hll = jstream::of(v).approxCountDistinct(14);
+        double estimate = hll.estimate();
+        CHECK(u.empty() ? estimate == 0 : std::abs(estimate - distinct) / distinct < 0.03);
+        std::stringstream bytes;
+        hll.serialize(bytes);
+        CHECK(jstream::HyperLogLog::deserialize(bytes).estimate() == estimate);
+        auto front = jstream::of(v.begin(), v.begin() + n / 2).approxCountDistinct(14);
+        auto back = jstream::of(v.begin() + n / 2, v.end()).approxCountDistinct(14);
+        front.merge(back);
+        CHECK(u.empty() || std::abs(front.estimate() - distinct) / distinct < 0.03);
+    }
+    bool rejected = false;
+    try
+    {
+        jstream::HyperLogLog p14(14), p10(10);
+        p14.merge(p10);
+    }
+    catch (std::invalid_argument const &)
+    {
+        rejected = true;
+    }
+    CHECK(rejected);
+
+    // KLL quantiles stay within the requested rank error, also after merging and round-tripping.
+    std::vector<double> d(400000);
+    std::normal_distribution<double> normal;
+    for (auto &x : d)
+        x = normal(rng);
+    std::vector<double> sorted = d;
+    std::sort(sorted.begin(), sorted.end());
+    auto kll = jstream::of(d).approxQuantiles(0.01);
+    CHECK(kll.count() == d.size());
+    for (double p : {0.01, 0.1, 0.5, 0.9, 0.99})
+        CHECK(std::abs(rankOf(sorted, *kll.quantile(p)) - p) < 0.01);
+    auto front = jstream::of(d.begin(), d.begin() + 200000).approxQuantiles(0.01);
+    auto back = jstream::of(d.begin() + 200000, d.end()).approxQuantiles(0.01);
+    front.merge(back);
+    CHECK(front.count() == d.size());
+    double median = *front.quantile(0.5);
+    CHECK(std::abs(rankOf(sorted, median) - 0.5) < 0.01);
+    std::stringstream bytes;
+    front.serialize(bytes);
+    auto restored = jstream::KllSketch<double>::deserialize(bytes);
+    CHECK(*restored.quantile(0.5) == median && restored.count() == d.size());
+
+    // Space-saving finds the heads of a geometric distribution with a long uniform tail.
+    std::vector<int> z;
+    for (int i = 0; i < 200000; i++)
+    {
+        int r = 1;
+        while (rng() % 2 && r < 40)
+            r++;
+        z.push_back(r == 40 ? int(rng() % 100000) + 100 : r);
+    }
+    auto hitters = jstream::of(z).heavyHitters(10);
+    auto top = hitters.top();
+    CHECK(top[0].item == 1 && top[1].item == 2 && top[2].item == 3);
+    for (auto const &counter : top)
+    {
+        auto exact = std::size_t(std::count(z.begin(), z.end(), counter.item));
+        CHECK(counter.count >= exact && counter.count - counter.error <= exact);
+    }
+    auto h1 = jstream::of(z.begin(), z.begin() + 100000).heavyHitters(10);
+    auto h2 = jstream::of(z.begin() + 100000, z.end()).heavyHitters(10);
+    h1.merge(h2);
+    CHECK(h1.top()[0].item == 1 && h1.top()[1].item == 2);
+    std::stringstream counters;
+    h1.serialize(counters);
+    CHECK(jstream::SpaceSaving<int>::deserialize(counters).top()[0].count == h1.top()[0].count);
+}
@@ -0,0 +1,96 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+template <typename T>
+void checkSorted(std::vector<T> const &v, jstream::Executor &executor)
+{
+    std::vector<T> expected = v, sequential, parallel;
+    std::sort(expected.begin(), expected.end());
+    jstream::of(v).sort().forEach([&](T x) { sequential.push_back(x); });
+    jstream::of(v).parallel(executor).sort().forEach([&](T x) { parallel.push_back(x); });
+    CHECK(sequential == expected);
+    CHECK(parallel == expected);
+}
+
+int main()
+{
+    std::mt19937_64 rng(5);
+    jstream::Executor executor(4);
+    for (std::size_t n : {0, 1, 2, 100, 5000, 300000})
+    {
+        std::vector<std::int64_t> wide(n);
+        std::vector<int> narrow(n);
+        std::vector<double> doubles(n);
+        std::vector<float> floats(n);
+        std::vector<std::uint8_t> bytes(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            wide[i] = std::int64_t(rng());
+            narrow[i] = int(rng() % 1000) - 500;
+            doubles[i] = (double(rng() % 2000000) - 1000000) / 7.0;
+            floats[i] = float(std::int64_t(rng() % 200) - 100) * 1e-3f;
+            bytes[i] = std::uint8_t(rng());
+        }
+        checkSorted(wide, executor);
+        checkSorted(narrow, executor);
+        checkSorted(doubles, executor);
+        checkSorted(floats, executor);
+        checkSorted(bytes, executor);
+    }
+
+    // Signed zeros and infinities keep their order under the sign-flip mapping.
+    std::vector<double> special{1.0, -0.0, 0.0, -1e300, 1e300, -1.0, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+    std::vector<double> ordered;
+    jstream::of(special).sort().forEach([&](double x) { ordered.push_back(x); });
+    CHECK(std::is_sorted(ordered.begin(), ordered.end()));
+    CHECK(std::signbit(ordered[3]) && !std::signbit(ordered[4]));
+
+    // sortedByKey is stable, with radix and comparison keys.
+    struct Record
+    {
+        int id;
+        double score;
+        std::string name;
+    };
+    std::vector<Record> records;
+    for (int i = 0; i < 20000; i++)
+        records.push_back({i, double(rng() % 100) - 50.5, std::to_string(rng() % 1000)});
+    for (bool parallel : {false, true})
+    {
+        std::vector<Record> out;
+        auto key = [](Record const &r) { return -r.score; };
+        if (parallel)
+            jstream::of(records).parallel(executor).sortedByKey(key).forEach([&](Record const &r) { out.push_back(r); });
+        else
+            jstream::of(records).sortedByKey(key).forEach([&](Record const &r) { out.push_back(r); });
+        CHECK(out.size() == records.size());
+        for (std::size_t i = 1; i < out.size(); i++)
+        {
+            CHECK(out[i - 1].score >= out[i].score);
+            if (out[i - 1].score == out[i].score)
+                CHECK(out[i - 1].id < out[i].id);
+        }
+    }
+    std::vector<Record> byName;
+    jstream::of(records).sortedByKey([](Record const &r) { return r.name; }).forEach([&](Record const &r) { byName.push_back(r); });
+    for (std::size_t i = 1; i < byName.size(); i++)
+        CHECK(byName[i - 1].name < byName[i].name || (byName[i - 1].name == byName[i].name && byName[i - 1].id < byName[i].id));
+
+    std::vector<std::string> strings{"b", "a", "c"}, descending;
+    jstream::of(strings).sort(std::greater<>{}).forEach([&](std::string const &s) { descending.push_back(s); });
+    CHECK((descending == std::vector<std::string>{"c", "b", "a"}));
+
+    // The result is sorted and random access.
+    std::vector<int> duplicates{3, 1, 3, 2, 1};
+    CHECK(jstream::of(duplicates).sort().groupBy(std::identity{}, jstream::count()).count() == 3);
+    CHECK(jstream::of(duplicates).sort().at(0) == 1);
+}
@@ -0,0 +1,76 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Record
+{
+    std::string line;
+    int id;
+};
+
+int main()
+{
+    std::mt19937_64 rng(9);
+    jstream::Executor executor(4);
+    for (std::size_t n : {0, 1, 2, 7, 1000, 100000})
+    {
+        // Keys share long prefixes, so many tie on their first 8 bytes, and some are shorter
+        // than 8 bytes.
+        std::vector<Record> v(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            std::string key = "key" + std::to_string(rng() % 50);
+            if (rng() % 3 == 0)
+                key = key.substr(0, rng() % 4);
+            v[i] = {key + ",x", int(i)};
+        }
+        auto field = [](Record const &r) { return r.line.substr(0, r.line.find(',')); };
+        std::vector<Record> expected = v;
+        std::stable_sort(expected.begin(), expected.end(), [&](Record const &a, Record const &b) { return field(a) < field(b); });
+
+        // Each key is computed exactly once per sort.
+        std::atomic<std::size_t> calls{0};
+        auto counted = [&](Record const &r) {
+            calls++;
+            return field(r);
+        };
+        std::vector<Record> sequential, parallel, descending;
+        jstream::of(v).sortedBy(counted).forEach([&](Record const &r) { sequential.push_back(r); });
+        CHECK(calls == n);
+        jstream::of(v).parallel(executor).sortedBy(counted).forEach([&](Record const &r) { parallel.push_back(r); });
+        CHECK(calls == 2 * n);
+        jstream::of(v).sortedBy(counted, std::greater<>{}).forEach([&](Record const &r) { descending.push_back(r); });
+        CHECK(calls == 3 * n);
+
+        CHECK(sequential.size() == n && parallel.size() == n && descending.size() == n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            CHECK(sequential[i].id == expected[i].id);
+            CHECK(parallel[i].id == expected[i].id);
+        }
+        for (std::size_t i = 1; i < n; i++)
+        {
+            std::string x = field(descending[i - 1]), y = field(descending[i]);
+            CHECK(x > y || (x == y && descending[i - 1].id < descending[i].id));
+        }
+
+        // Arithmetic keys take the radix path.
+        std::vector<Record> reversed;
+        jstream::of(v).sortedBy([](Record const &r) { return -r.id; }).forEach([&](Record const &r) { reversed.push_back(r); });
+        for (std::size_t i = 0; i < n; i++)
+            CHECK(reversed[i].id == int(n - 1 - i));
+    }
+
+    // Keys differing only past the 8-byte prefix, and embedded zero bytes.
+    std::vector<std::string> strings{"abcdefghZ", "abcdefghA", "abcdefgh", std::string("ab\0c", 4), "ab", "abcdefgh\0", ""};
+    std::vector<std::string> expected = strings, got;
+    std::stable_sort(expected.begin(), expected.end());
+    jstream::of(strings).sortedBy(std::identity{}).forEach([&](std::string const &s) { got.push_back(s); });
+    CHECK(got == expected);
+}
@@ -0,0 +1,69 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Reading
+{
+    int sensor;
+    double value;
+};
+
+int main()
+{
+    std::mt19937 rng(33);
+    std::vector<long> v(300000);
+    for (auto &x : v)
+        x = long(rng() % 50000);
+    std::map<long, long> sums;
+    for (long x : v)
+        sums[x % 20000] += x;
+    std::set<long> unique(v.begin(), v.end());
+
+    // Budgets from unbounded down to zero, which spills every new key and recurses to maxDepth.
+    for (std::size_t budget : {std::size_t(-1), std::size_t(100000), std::size_t(1000), std::size_t(0)})
+    {
+        std::map<long, long> grouped;
+        jstream::of(v).groupBy([](long x) { return x % 20000; }, jstream::sum(), budget).forEach([&](auto const &group) {
+            CHECK(!grouped.count(group.first));
+            grouped[group.first] = group.second;
+        });
+        CHECK(grouped == sums);
+
+        std::set<long> seen;
+        std::size_t n = 0;
+        jstream::of(v).distinct(budget).forEach([&](long x) {
+            seen.insert(x);
+            n++;
+        });
+        CHECK(n == unique.size());
+        CHECK(seen == unique);
+    }
+
+    // Trivially copyable structs spill as raw bytes.
+    std::vector<Reading> readings(20000);
+    std::map<int, std::size_t> perSensor;
+    for (auto &r : readings)
+    {
+        r = {int(rng() % 3000), double(rng() % 100)};
+        perSensor[r.sensor]++;
+    }
+    std::map<int, std::size_t> counted;
+    jstream::of(readings).groupBy([](Reading const &r) { return r.sensor; }, jstream::count(), 4096).forEach([&](auto const &group) {
+        counted[group.first] = group.second;
+    });
+    CHECK(counted == perSensor);
+
+    // Without a budget distinct keeps first-occurrence order and takes any hashable type.
+    std::vector<std::string> words{"a", "b", "a", "c", "b"};
+    CHECK(jstream::of(words).distinct().count() == 3);
+    CHECK(jstream::of(words).groupBy([](auto const &x) { return x; }, jstream::count()).count() == 3);
+    std::vector<int> few{3, 1, 3, 3, 2, 1};
+    std::vector<int> order;
+    jstream::of(few).distinct().forEach([&](int x) { order.push_back(x); });
+    CHECK((order == std::vector<int>{3, 1, 2}));
+}
@@ -0,0 +1,59 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <random>
+#include <vector>
+
+template <typename Stats>
+void checkAgainst(Stats const &s, std::vector<double> const &v)
+{
+    double mean = 0;
+    for (double x : v)
+        mean += x;
+    mean /= double(v.size());
+    double variance = 0;
+    for (double x : v)
+        variance += (x - mean) * (x - mean);
+    variance /= double(v.size());
+    CHECK(s.count() == v.size());
+    CHECK(std::abs(s.mean() - mean) < 1e-6);
+    CHECK(std::abs(s.variance() - variance) / variance < 1e-6);
+    CHECK(s.min() == *std::min_element(v.begin(), v.end()));
+    CHECK(s.max() == *std::max_element(v.begin(), v.end()));
+}
+
+int main()
+{
+    // A large offset with a small spread is where naive sum-of-squares variance breaks down.
+    std::mt19937 rng(34);
+    std::normal_distribution<double> normal(1e6, 3.0);
+    std::vector<double> v(100003);
+    for (auto &x : v)
+        x = normal(rng);
+    std::list<double> l(v.begin(), v.end());
+    checkAgainst(jstream::of(v).summaryStatistics(), v);
+    checkAgainst(jstream::of(l).summaryStatistics(), v);
+    checkAgainst(jstream::of(v).map([](double x) { return x; }).summaryStatistics(), v);
+
+    std::vector<int> iv{3, -1, 7, 2};
+    auto all = jstream::of(iv).summaryStatistics();
+    CHECK(all.sum() == 11 && all.min() == -1 && all.max() == 7 && all.count() == 4);
+    auto front = jstream::of(iv.begin(), iv.begin() + 2).summaryStatistics();
+    auto back = jstream::of(iv.begin() + 2, iv.end()).summaryStatistics();
+    front.merge(back);
+    CHECK(front.sum() == 11 && front.min() == -1 && front.max() == 7);
+    CHECK(std::abs(front.variance() - all.variance()) < 1e-12);
+
+    std::vector<std::pair<bool, std::size_t>> groups;
+    jstream::of(iv).groupBy([](int x) { return x > 0; }, jstream::summarizing()).forEach([&](auto const &group) {
+        groups.emplace_back(group.first, group.second.count());
+    });
+    std::sort(groups.begin(), groups.end());
+    CHECK((groups == std::vector<std::pair<bool, std::size_t>>{{false, 1}, {true, 3}}));
+
+    std::vector<int> none;
+    CHECK(jstream::of(none).summaryStatistics().count() == 0);
+}
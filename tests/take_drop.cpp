@@ -0,0 +1,61 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <list>
+#include <random>
+#include <vector>
+
+template <typename S>
+std::vector<int> collect(S &&s)
+{
+    std::vector<int> out;
+    s.forEach([&](int x) { out.push_back(x); });
+    return out;
+}
+
+int main()
+{
+    std::mt19937 rng(28);
+    for (std::size_t n : {0, 1, 5, 100, 1000})
+    {
+        std::vector<int> v(n);
+        for (auto &x : v)
+            x = int(rng() % 100);
+        std::list<int> l(v.begin(), v.end());
+        auto small = [](int x) { return x < 90; };
+        auto split = std::find_if_not(v.begin(), v.end(), small);
+        std::vector<int> head(v.begin(), split), tail(split, v.end());
+        CHECK(collect(jstream::of(v).takeWhile(small)) == head);
+        CHECK(collect(jstream::of(l).takeWhile(small)) == head);
+        CHECK(collect(jstream::of(v).dropWhile(small)) == tail);
+        CHECK(collect(jstream::of(l).dropWhile(small)) == tail);
+
+        // Monotonic predicates over sorted random-access input binary search the boundary.
+        std::vector<int> sorted = v;
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t calls = 0;
+        auto counted = [&](int x) {
+            calls++;
+            return x < 50;
+        };
+        auto boundary = std::size_t(std::lower_bound(sorted.begin(), sorted.end(), 50) - sorted.begin());
+        CHECK(jstream::of(sorted).takeWhile(counted, jstream::monotonic).count() == boundary);
+        CHECK(calls <= 2 * std::size_t(std::bit_width(n)) + 2);
+        calls = 0;
+        CHECK(collect(jstream::of(sorted).dropWhile(counted, jstream::monotonic)) == std::vector<int>(sorted.begin() + boundary, sorted.end()));
+        CHECK(calls <= 2 * std::size_t(std::bit_width(n)) + 2);
+        CHECK(collect(jstream::of(sorted).takeWhile(counted, jstream::monotonic).limit(3)) == std::vector<int>(sorted.begin(), sorted.begin() + std::min<std::size_t>(3, boundary)));
+    }
+
+    // takeWhile stops pulling upstream once the predicate fails.
+    std::vector<std::vector<int>> nested{{1, 2}, {}, {3}, {9, 1}, {4}, {5}};
+    int pulled = 0;
+    int sum = jstream::of(nested)
+                  .peek([&](auto const &) { pulled++; })
+                  .flatMap([](std::vector<int> const &x) { return jstream::of(x); })
+                  .takeWhile([](int x) { return x < 5; })
+                  .sum();
+    CHECK(sum == 6);
+    CHECK(pulled == 4);
+}
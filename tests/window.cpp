@@ -0,0 +1,93 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <list>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using Windows = std::vector<std::vector<int>>;
+
+template <typename S>
+Windows collect(S &&s)
+{
+    Windows out;
+    s.forEach([&](auto window) { out.emplace_back(window.begin(), window.end()); });
+    return out;
+}
+
+Windows reference(std::vector<int> const &v, std::size_t size, std::size_t step, bool partial)
+{
+    Windows out;
+    for (std::size_t i = 0; i < v.size(); i += step)
+    {
+        if (i + size > v.size() && !partial)
+            break;
+        out.emplace_back(v.begin() + i, v.begin() + std::min(v.size(), i + size));
+    }
+    return out;
+}
+
+template <typename F>
+bool throwsInvalidArgument(F f)
+{
+    try
+    {
+        f();
+    }
+    catch (std::invalid_argument const &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    std::mt19937 rng(27);
+    for (std::size_t n : {0, 1, 2, 7, 64, 301})
+    {
+        std::vector<int> v(n);
+        for (auto &x : v)
+            x = int(rng() % 1000) - 500;
+        std::list<int> l(v.begin(), v.end());
+
+        for (std::size_t size : {1, 2, 3, 8})
+            for (std::size_t step : {1, 2, 3, 8, 11})
+            {
+                // The contiguous path slices the input, the sequential one goes through the ring.
+                CHECK(collect(jstream::of(v).window(size, step)) == reference(v, size, step, false));
+                CHECK(collect(jstream::of(l).window(size, step)) == reference(v, size, step, false));
+            }
+        for (std::size_t size : {1, 3, 10})
+        {
+            CHECK(collect(jstream::of(v).chunk(size)) == reference(v, size, size, true));
+            CHECK(collect(jstream::of(l).chunk(size)) == reference(v, size, size, true));
+            CHECK(jstream::of(v).window(size).count() == reference(v, size, 1, false).size());
+
+            std::vector<long> sums, mins, maxs;
+            jstream::of(l).map([](int x) { return long(x); }).slidingSum(size).forEach([&](long x) { sums.push_back(x); });
+            jstream::of(l).slidingMin(size).forEach([&](int x) { mins.push_back(x); });
+            jstream::of(l).slidingMax(size).forEach([&](int x) { maxs.push_back(x); });
+            auto expected = reference(v, size, 1, false);
+            CHECK(sums.size() == expected.size() && mins.size() == expected.size() && maxs.size() == expected.size());
+            for (std::size_t i = 0; i < expected.size(); i++)
+            {
+                auto const &w = expected[i];
+                CHECK(sums[i] == std::accumulate(w.begin(), w.end(), 0L));
+                CHECK(mins[i] == *std::min_element(w.begin(), w.end()));
+                CHECK(maxs[i] == *std::max_element(w.begin(), w.end()));
+            }
+        }
+    }
+
+    std::vector<int> v{1, 2, 3};
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).chunk(0); }));
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).window(0); }));
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).window(2, 0); }));
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).slidingSum(0); }));
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).slidingMin(0); }));
+    CHECK(throwsInvalidArgument([&] { jstream::of(v).slidingMax(0); }));
+}
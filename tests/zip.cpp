@@ -0,0 +1,47 @@
+#include "jstream.hpp"
+#include "check.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+int main()
+{
+    std::vector<double> a{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    std::vector<double> b(12, 2.0);
+    CHECK(jstream::zipWith([](double x, double y) { return x * y; }, jstream::of(a), jstream::of(b)).sum() == 110);
+    CHECK(jstream::zip(jstream::of(a), jstream::of(b)).count() == 10);
+
+    // Mixed random-access and sequential inputs stop at the shortest one.
+    std::list<int> l{1, 2, 3};
+    std::vector<int> v{10, 20, 30, 40};
+    int dot = 0;
+    jstream::zip(jstream::of(l), jstream::of(v)).forEach([&](auto t) {
+        auto [x, y] = t;
+        dot += x * y;
+    });
+    CHECK(dot == 140);
+    CHECK(jstream::zipWith([](int x, int y) { return x + y; }, jstream::of(v).filter([](int x) { return x > 10; }), jstream::of(l)).sum() == 96);
+
+    // zip yields references into the inputs.
+    std::vector<int> w{1, 2, 3, 4};
+    jstream::zip(jstream::of(v), jstream::of(w)).forEach([](auto t) { std::get<0>(t) += std::get<1>(t); });
+    CHECK((v == std::vector<int>{11, 22, 33, 44}));
+
+    // forEach hands lvalues to f on the indexed path too.
+    std::vector<std::string> seen;
+    jstream::of(w).map([](int x) { return std::to_string(x); }).forEach([&](std::string &s) { seen.push_back(std::move(s)); });
+    CHECK((seen == std::vector<std::string>{"1", "2", "3", "4"}));
+
+    std::vector<float> x(1001), y(1001);
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = float(i % 7);
+        y[i] = float(i % 3);
+    }
+    double expected = 0;
+    for (std::size_t i = 0; i < x.size(); i++)
+        expected += x[i] * y[i];
+    CHECK(jstream::zipWith([](float p, float q) { return p * q; }, jstream::of(x), jstream::of(y)).sum() == float(expected));
+    CHECK(jstream::of(v).map([](int i) { return i * 2; }).limit(3).sum() == 132);
+}